@@ -3,8 +3,11 @@
 #include <SDL2/SDL.h>
 
 #include <SDL2/SDL_events.h>
+#include <cstdint>
 #include <memory>
 #include "font_manager.h"
+#include "render_commands.h"
+#include "scheduler.h"
 
 class Scene;
 
@@ -18,8 +21,20 @@ class SceneManager {
 class Scene {
  public:
   SceneManager& sceneManager;
-  virtual void handleInput(const SDL_Event& event) = 0;
-  virtual void update() = 0;
-  virtual void render(SDL_Renderer* renderer) = 0;
+  // `time` and `now` are nowMicros() timestamps
+  virtual void handleInput(const SDL_Event& event, uint64_t time) = 0;
+  virtual void update(uint64_t now) = 0;
+  // Records the frame into `commands`; the backend does the drawing
+  virtual void render(CommandList& commands) = 0;
+  // When update() next has work to do even without input, or NO_DEADLINE
+  virtual uint64_t nextDeadline() { return NO_DEADLINE; }
+
+  // Set when the next frame would differ from the last one presented;
+  // the main loop clears it after presenting
+  bool dirty = true;
+  void invalidate() { dirty = true; }
+  // Scenes that animate keep the default. Static ones return dirty, and the
+  // main loop then sleeps until input, a window event or nextDeadline().
+  virtual bool needsRedraw() { return true; }
   Scene(SceneManager& manager) : sceneManager(manager) {};
 };
@@ -1,6 +1,44 @@
 import os
 import platform
-from SCons.Script import Environment
+import struct
+from SCons.Script import ARGUMENTS, Environment, Glob
+
+# Keep in sync with asset_pack.h
+PACK_MAGIC = 0x4b415054
+PACK_VERSION = 1
+PACK_ALIGN = 64
+PACK_NAME_SIZE = 48
+
+
+def pack_assets(target, source, env):
+    """Packs every asset into one archive: header, table of contents, then
+    each file's bytes aligned to PACK_ALIGN."""
+    blobs = []
+    for node in source:
+        with open(str(node), 'rb') as f:
+            blobs.append((os.path.basename(str(node)), f.read()))
+
+    header_size = 16 + len(blobs) * (PACK_NAME_SIZE + 16)
+    offset = header_size
+    toc = []
+    for name, data in blobs:
+        offset = (offset + PACK_ALIGN - 1) // PACK_ALIGN * PACK_ALIGN
+        toc.append((name, offset, len(data)))
+        offset += len(data)
+
+    with open(str(target[0]), 'wb') as out:
+        out.write(struct.pack('<IIII', PACK_MAGIC, PACK_VERSION, len(blobs), 0))
+        for name, offset, size in toc:
+            encoded = name.encode('utf-8')
+            if len(encoded) >= PACK_NAME_SIZE:
+                raise ValueError('asset name too long: ' + name)
+            out.write(struct.pack('<{}sQQ'.format(PACK_NAME_SIZE), encoded,
+                                  offset, size))
+        for (name, offset, size), (_, data) in zip(toc, blobs):
+            out.write(b'\0' * (offset - out.tell()))
+            out.write(data)
+    return None
+
 
 # These should be standard install paths
 if platform.system() == "Linux":
@@ -12,6 +50,41 @@ else:
     print("Unsupported environment")
     env = Environment()
 
-source_files = ['main.cpp', 'tetris.cpp', 'font_manager.cpp']
+# `scons debug=1` keeps the debug-only consistency checks, such as the full
+# board scan after every change. Other builds define NDEBUG.
+if ARGUMENTS.get('debug', '0') == '0':
+    env.Append(CPPDEFINES=['NDEBUG'])
+
+source_files = ['main.cpp', 'tetris.cpp', 'tetris_game.cpp', 'font_manager.cpp',
+                'asset_pack.cpp', 'music_sequencer.cpp', 'render_backend.cpp',
+                'software_backend.cpp']
+
+tetris = env.Program(target='tetris', source=source_files)
+pack = env.Command('assets.pak', sorted(Glob('assets/*'), key=str), pack_assets)
+env.Default(tetris, pack)
 
-env.Program(target='tetris', source=source_files)
+# Benchmarks are only built when asked for, e.g. `scons bench_audio`
+env.Alias('bench_audio', env.Program(target='bench/bench_audio',
+                                     source=['bench/bench_audio.cpp']))
+render_sources = ['font_manager.cpp', 'asset_pack.cpp', 'render_backend.cpp',
+                  'software_backend.cpp']
+# the game's own drawing, for tools that render scenes headlessly
+scene_sources = render_sources + ['tetris.cpp', 'tetris_game.cpp',
+                                  'music_sequencer.cpp']
+env.Alias('bench_raster',
+          env.Program(target='bench/bench_raster',
+                      source=['bench/bench_raster.cpp'] + render_sources))
+env.Alias('render_check',
+          env.Program(target='bench/render_check',
+                      source=['bench/render_check.cpp'] + scene_sources))
+env.Alias('bench_render',
+          env.Program(target='bench/bench_render',
+                      source=['bench/bench_render.cpp'] + scene_sources))
+env.Alias('bench_core',
+          env.Program(target='bench/bench_core',
+                      source=['bench/bench_core.cpp', 'tetris_game.cpp',
+                              'music_sequencer.cpp', 'asset_pack.cpp']))
+env.Alias('replay_check',
+          env.Program(target='bench/replay_check',
+                      source=['bench/replay_check.cpp', 'tetris_game.cpp',
+                              'music_sequencer.cpp', 'asset_pack.cpp']))
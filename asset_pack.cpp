@@ -0,0 +1,92 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_rwops.h>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "asset_pack.h"
+
+const char* PACK_NAME = "assets.pak";
+const char* LOOSE_ASSET_DIR = "assets";
+
+// The directory holding the pack or assets/, found from the executable
+// rather than the working directory so the game runs from anywhere. Tools
+// built into bench/ find them one level up.
+std::filesystem::path assetRoot() {
+  char* basePath = SDL_GetBasePath();
+  if (!basePath) {
+    return std::filesystem::current_path();
+  }
+  // drop the trailing separator SDL leaves on
+  std::filesystem::path base = std::filesystem::path(basePath).parent_path();
+  SDL_free(basePath);
+  for (const std::filesystem::path& dir : {base, base.parent_path()}) {
+    std::error_code error;
+    if (std::filesystem::exists(dir / PACK_NAME, error) ||
+        std::filesystem::is_directory(dir / LOOSE_ASSET_DIR, error)) {
+      return dir;
+    }
+  }
+  return base;
+}
+
+AssetPack::AssetPack()
+    : root(assetRoot()), pack((root / PACK_NAME).string()) {
+  if (!pack.valid()) {
+    return;
+  }
+
+  PackHeader header;
+  if (pack.size() < sizeof(header)) {
+    pack = MappedFile();
+    return;
+  }
+  std::memcpy(&header, pack.data(), sizeof(header));
+  size_t tocEnd = sizeof(header) + (size_t)header.count * sizeof(PackEntry);
+  if (header.magic != PACK_MAGIC || header.version != PACK_VERSION ||
+      tocEnd > pack.size()) {
+    std::cout << "ignoring invalid " << (root / PACK_NAME).string()
+              << std::endl;
+    pack = MappedFile();
+    return;
+  }
+
+  for (uint32_t i = 0; i < header.count; i++) {
+    PackEntry entry;
+    std::memcpy(&entry, pack.data() + sizeof(header) + i * sizeof(entry),
+                sizeof(entry));
+    if (entry.offset + entry.size > pack.size()) {
+      continue;
+    }
+    std::string name(entry.name, strnlen(entry.name, PACK_NAME_SIZE));
+    entries[name] = {pack.data() + entry.offset, (size_t)entry.size};
+  }
+}
+
+AssetData AssetPack::get(const std::string& name) {
+  if (pack.valid()) {
+    auto it = entries.find(name);
+    return it == entries.end() ? AssetData() : it->second;
+  }
+
+  std::lock_guard<std::mutex> lock(looseMutex);
+  auto it = looseFiles.find(name);
+  if (it == looseFiles.end()) {
+    std::string path = (root / LOOSE_ASSET_DIR / name).string();
+    it = looseFiles.emplace(name, MappedFile(path)).first;
+  }
+  if (!it->second.valid()) {
+    return AssetData();
+  }
+  return {it->second.data(), it->second.size()};
+}
+
+SDL_RWops* AssetPack::open(const std::string& name) {
+  AssetData asset = get(name);
+  if (!asset.data) {
+    SDL_SetError("missing asset %s", name.c_str());
+    return NULL;
+  }
+  return SDL_RWFromConstMem(asset.data, (int)asset.size);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_rwops.h>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "mapped_file.h"
+
+// Layout of assets.pak, written by pack_assets in Sconstruct.py. Everything
+// is little endian: a PackHeader, `count` PackEntry records, then each
+// asset's bytes starting on a PACK_ALIGN boundary.
+const uint32_t PACK_MAGIC = 0x4b415054;  // "TPAK"
+const uint32_t PACK_VERSION = 1;
+const uint32_t PACK_ALIGN = 64;
+const int PACK_NAME_SIZE = 48;
+
+struct PackHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t count;
+  uint32_t reserved;
+};
+
+struct PackEntry {
+  char name[PACK_NAME_SIZE];
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct AssetData {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+};
+
+// Serves every asset out of one memory mapped archive. When the pack hasn't
+// been built (e.g. running the prebuilt tetris.exe) assets are mapped one by
+// one from assets/ instead, so callers always get the same in-memory path.
+// Both are looked for next to the executable, whatever the working
+// directory.
+class AssetPack {
+ private:
+  // where assets.pak and assets/ are
+  std::filesystem::path root;
+  MappedFile pack;
+  std::unordered_map<std::string, AssetData> entries;
+  // loose files, only used without a pack
+  std::unordered_map<std::string, MappedFile> looseFiles;
+  std::mutex looseMutex;
+
+  AssetPack();
+
+ public:
+  static AssetPack& getInstance() {
+    static AssetPack assetPack;
+    return assetPack;
+  }
+
+  // Stays valid for the life of the program
+  AssetData get(const std::string& name);
+
+  // A read only RWops over the asset, or NULL if it doesn't exist
+  SDL_RWops* open(const std::string& name);
+
+  // The directory assets.pak and assets/ are looked for in
+  const std::filesystem::path& directory() const { return root; }
+};
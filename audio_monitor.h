@@ -0,0 +1,136 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <SDL2/SDL_timer.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+// Watches the mixer callback to catch underruns and to measure how long a
+// triggered sound takes to reach the speakers.
+//
+// An underrun is counted whenever the device asks for data noticeably later
+// than one buffer period after the previous request, meaning the queue ran
+// dry. Latency is measured from markTrigger() to the next mix callback plus
+// the one buffer that callback fills before it is heard.
+class AudioMonitor {
+ private:
+  std::atomic<uint64_t> lastCallback = 0;
+  std::atomic<uint64_t> pendingTrigger = 0;
+  std::atomic<uint64_t> callbacks = 0;
+  std::atomic<uint64_t> underrunCount = 0;
+  std::atomic<uint64_t> latencyTotal = 0;
+  std::atomic<uint64_t> latencyMax = 0;
+  std::atomic<uint64_t> latencyCount = 0;
+  uint64_t period = 0;
+  uint64_t lateThreshold = 0;
+
+  AudioMonitor() = default;
+
+  static void postMix(void* udata, Uint8* stream, int len) {
+    static_cast<AudioMonitor*>(udata)->onCallback();
+  }
+
+  void onCallback() {
+    uint64_t now = SDL_GetPerformanceCounter();
+    uint64_t last = lastCallback.exchange(now);
+    if (last != 0 && now - last > lateThreshold) {
+      underrunCount++;
+    }
+    callbacks++;
+
+    uint64_t trigger = pendingTrigger.exchange(0);
+    if (trigger != 0 && trigger <= now) {
+      uint64_t latency = now - trigger + period;
+      latencyTotal += latency;
+      latencyCount++;
+      uint64_t max = latencyMax;
+      while (latency > max && !latencyMax.compare_exchange_weak(max, latency)) {
+      }
+    }
+  }
+
+ public:
+  static AudioMonitor& getInstance() {
+    static AudioMonitor audioMonitor;
+    return audioMonitor;
+  }
+
+  // Starts watching the currently open device
+  void attach(int frequency, int bufferSamples) {
+    uint64_t ticksPerSecond = SDL_GetPerformanceFrequency();
+    period = ticksPerSecond * bufferSamples / frequency;
+    lateThreshold = period * 3 / 2;
+    reset();
+    Mix_SetPostMix(postMix, this);
+  }
+
+  void detach() { Mix_SetPostMix(NULL, NULL); }
+
+  void reset() {
+    lastCallback = 0;
+    pendingTrigger = 0;
+    callbacks = 0;
+    underrunCount = 0;
+    latencyTotal = 0;
+    latencyMax = 0;
+    latencyCount = 0;
+  }
+
+  // Call right after asking the mixer to play something
+  void markTrigger() {
+    uint64_t expected = 0;
+    pendingTrigger.compare_exchange_strong(expected,
+                                           SDL_GetPerformanceCounter());
+  }
+
+  uint64_t underruns() const { return underrunCount; }
+  uint64_t callbackCount() const { return callbacks; }
+
+  double averageLatencyMs() const {
+    uint64_t count = latencyCount;
+    if (count == 0) {
+      return 0;
+    }
+    return latencyTotal * 1000.0 / count / SDL_GetPerformanceFrequency();
+  }
+
+  double maxLatencyMs() const {
+    return latencyMax * 1000.0 / SDL_GetPerformanceFrequency();
+  }
+
+  void report() const {
+    std::cout << "audio: " << callbackCount() << " callbacks, " << underruns()
+              << " underruns, latency avg " << averageLatencyMs()
+              << " ms, max " << maxLatencyMs() << " ms" << std::endl;
+  }
+};
+
+const int LOW_LATENCY_BUFFERS[] = {128, 256, 512};
+const uint32_t LATENCY_PROBE_MS = 250;
+
+// Opens the mixer with the smallest buffer that gets through a short probe
+// without underruns and leaves the monitor attached. Returns the buffer
+// size, or 0 if no low latency buffer was stable.
+inline int openLowLatencyAudio() {
+  AudioMonitor& monitor = AudioMonitor::getInstance();
+  for (int samples : LOW_LATENCY_BUFFERS) {
+    if (Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT,
+                      MIX_DEFAULT_CHANNELS, samples) < 0) {
+      continue;
+    }
+    int frequency;
+    Mix_QuerySpec(&frequency, NULL, NULL);
+    monitor.attach(frequency, samples);
+    SDL_Delay(LATENCY_PROBE_MS);
+    if (monitor.callbackCount() > 0 && monitor.underruns() == 0) {
+      monitor.reset();
+      return samples;
+    }
+    monitor.detach();
+    Mix_CloseAudio();
+  }
+  return 0;
+}
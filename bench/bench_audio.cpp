@@ -0,0 +1,138 @@
+// Runs the mixer on SDL's dummy (or disk) audio driver with each buffer
+// size while the main thread and a few worker threads burn CPU, then
+// reports underruns and trigger latency. Exits non-zero if the buffer the
+// low latency mode negotiates underruns under load.
+//
+//   bench_audio [dummy|disk] [seconds]
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <SDL2/SDL_timer.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../audio_monitor.h"
+
+const uint32_t FRAME_MS = 16;
+const uint32_t FRAME_WORK_MS = 12;
+
+struct LoadResult {
+  int samples;
+  uint64_t callbacks;
+  uint64_t underruns;
+  double averageLatencyMs;
+  double maxLatencyMs;
+};
+
+void burn(uint32_t ms) {
+  uint64_t end = SDL_GetPerformanceCounter() +
+                 SDL_GetPerformanceFrequency() * ms / 1000;
+  volatile uint64_t sink = 0;
+  while (SDL_GetPerformanceCounter() < end) {
+    sink = sink + 1;
+  }
+}
+
+// Plays a short silent chunk every simulated frame, like the game triggering
+// rotate and drop sounds, while everything else is busy.
+LoadResult runUnderLoad(int samples, uint32_t seconds) {
+  LoadResult result = {samples};
+  if (Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT,
+                    MIX_DEFAULT_CHANNELS, samples) < 0) {
+    std::cout << "could not open audio with " << samples
+              << " samples: " << Mix_GetError() << std::endl;
+    return result;
+  }
+  int frequency;
+  Uint16 format;
+  int channels;
+  Mix_QuerySpec(&frequency, &format, &channels);
+  std::vector<Uint8> silence(frequency / 20 * channels *
+                             SDL_AUDIO_BITSIZE(format) / 8);
+  Mix_Chunk* chunk = Mix_QuickLoad_RAW(silence.data(), silence.size());
+
+  AudioMonitor& monitor = AudioMonitor::getInstance();
+  monitor.attach(frequency, samples);
+
+  std::atomic<bool> running = true;
+  std::vector<std::thread> workers;
+  unsigned workerCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+  for (unsigned i = 0; i < workerCount; i++) {
+    workers.emplace_back([&running] {
+      while (running) {
+        burn(FRAME_MS);
+      }
+    });
+  }
+
+  uint32_t end = SDL_GetTicks() + seconds * 1000;
+  while (SDL_GetTicks() < end) {
+    Mix_PlayChannel(-1, chunk, 0);
+    monitor.markTrigger();
+    burn(FRAME_WORK_MS);
+    SDL_Delay(FRAME_MS - FRAME_WORK_MS);
+  }
+
+  running = false;
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  result.callbacks = monitor.callbackCount();
+  result.underruns = monitor.underruns();
+  result.averageLatencyMs = monitor.averageLatencyMs();
+  result.maxLatencyMs = monitor.maxLatencyMs();
+  monitor.detach();
+  Mix_HaltChannel(-1);
+  Mix_FreeChunk(chunk);
+  Mix_CloseAudio();
+  return result;
+}
+
+int main(int argc, char* argv[]) {
+  std::string driver = argc > 1 ? argv[1] : "dummy";
+  uint32_t seconds = argc > 2 ? std::atoi(argv[2]) : 3;
+  SDL_setenv("SDL_AUDIODRIVER", driver.c_str(), 1);
+  if (driver == "disk") {
+    SDL_setenv("SDL_DISKAUDIOFILE", "bench_audio.raw", 1);
+  }
+
+  if (SDL_Init(SDL_INIT_AUDIO) < 0) {
+    std::cout << "could not init audio: " << SDL_GetError() << std::endl;
+    return 1;
+  }
+
+  std::vector<int> sizes(std::begin(LOW_LATENCY_BUFFERS),
+                         std::end(LOW_LATENCY_BUFFERS));
+  sizes.push_back(2048);
+  std::cout << "driver " << SDL_GetCurrentAudioDriver() << ", " << seconds
+            << " s per buffer size" << std::endl;
+  for (int samples : sizes) {
+    LoadResult result = runUnderLoad(samples, seconds);
+    std::cout << samples << " samples: " << result.callbacks << " callbacks, "
+              << result.underruns << " underruns, latency avg "
+              << result.averageLatencyMs << " ms, max " << result.maxLatencyMs
+              << " ms" << std::endl;
+  }
+
+  int negotiated = openLowLatencyAudio();
+  AudioMonitor::getInstance().detach();
+  Mix_CloseAudio();
+  if (!negotiated) {
+    std::cout << "FAIL: no low latency buffer survived the probe" << std::endl;
+    SDL_Quit();
+    return 1;
+  }
+  LoadResult result = runUnderLoad(negotiated, seconds);
+  bool passed = result.callbacks > 0 && result.underruns == 0;
+  std::cout << (passed ? "PASS" : "FAIL") << ": negotiated " << negotiated
+            << " samples, " << result.underruns << " underruns under load"
+            << std::endl;
+  SDL_Quit();
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,247 @@
+// Microbenchmarks for the game's core operations, run over real positions
+// recorded with `tetris --record-positions=FILE`. Every operation is timed
+// over the whole set of positions, repeated after a warmup, and reported
+// as the median time per call with its median absolute deviation. Each
+// file runs on the TetrisGame instantiation for its board size, so giving
+// one recording per mode compares them. Without files every mode runs on
+// positions from random moves played from a fixed seed, which are the same
+// on every machine but messier than a real game's.
+//
+//   bench_core [FILE...] [--repetitions=N]
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../tetris_game.h"
+#include "game_bench.h"
+
+const int WARMUP = 3;
+// without recordings, positions come from this many random moves per mode
+const int GENERATED_MOVES = 20000;
+const uint64_t SEED = 7;
+
+volatile int sink;
+
+// Times `run` over `count` calls per repetition. `prepare` runs untimed
+// before each repetition, for operations that change the games they run on.
+void measure(const char* name,
+             size_t count,
+             int repetitions,
+             const std::function<void()>& prepare,
+             const std::function<void()>& run) {
+  if (count == 0) {
+    std::printf("%-26s no positions\n", name);
+    return;
+  }
+  std::vector<double> perCall;
+  for (int i = 0; i < WARMUP + repetitions; i++) {
+    prepare();
+    auto start = std::chrono::steady_clock::now();
+    run();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    if (i >= WARMUP) {
+      perCall.push_back(
+          std::chrono::duration<double, std::nano>(elapsed).count() / count);
+    }
+  }
+  std::sort(perCall.begin(), perCall.end());
+  double median = perCall[perCall.size() / 2];
+  std::vector<double> deviations;
+  for (double time : perCall) {
+    deviations.push_back(std::abs(time - median));
+  }
+  std::sort(deviations.begin(), deviations.end());
+  std::printf("%-26s %10.1f ns  +- %7.1f  (%zu calls)\n", name, median,
+              deviations[deviations.size() / 2], count);
+}
+
+// The positions in a log from `tetris --record-positions`
+template <typename G>
+std::vector<typename G::Position> readPositions(std::istream& in) {
+  std::vector<typename G::Position> positions;
+  typename G::Position position;
+  while (in.read((char*)&position, sizeof(position))) {
+    if (position.type >= 0 && position.type < PIECE_TYPES &&
+        position.rotation >= 0 && position.rotation < ROTATIONS) {
+      positions.push_back(position);
+    }
+  }
+  return positions;
+}
+
+// The pieces that lock in the random moves replay_check plays from SEED,
+// so there's something to run on without a recording
+template <typename G>
+std::vector<typename G::Position> generatePositions() {
+  using Bench = TetrisGameBench<G>;
+  std::vector<typename G::Position> positions;
+  G game(SEED);
+  RNG moves;
+  moves.seed(SEED, 1);
+  for (int i = 0; i < GENERATED_MOVES; i++) {
+    Bench::startOverIfStuck(game);
+    G before = game;
+    Bench::randomMove(game, moves.next());
+    if (game.locks() != before.locks()) {
+      positions.push_back(game.lockedPosition(before));
+    }
+  }
+  return positions;
+}
+
+// Runs every benchmark over `positions`, on game type G
+template <typename G>
+void benchGame(const char* mode,
+               const char* source,
+               const std::vector<typename G::Position>& positions,
+               int repetitions) {
+  using Bench = TetrisGameBench<G>;
+  std::cout << "\n" << mode << " (" << G::WIDTH << "x" << G::HEIGHT
+            << "): " << positions.size() << " " << source << " positions, "
+            << sizeof(G) << " bytes of game state" << std::endl;
+  if (positions.empty()) {
+    return;
+  }
+
+  std::vector<G> games(positions.size());
+  for (size_t i = 0; i < positions.size(); i++) {
+    games[i].restore(positions[i]);
+  }
+  // the same positions after the piece locks, sorted by lines it completes
+  std::vector<G> clears[5];
+  for (const G& game : games) {
+    G locked = game;
+    Bench::lock(locked);
+    clears[std::min(Bench::fullRows(locked), 4)].push_back(locked);
+  }
+  std::vector<G> lifted = games;
+  for (G& game : lifted) {
+    Bench::liftPiece(game);
+  }
+  // hard drops sorted by how far they fall, which shouldn't matter
+  const int FALL_BUCKETS = 4;
+  const int FALL_BUCKET_ROWS = 5;
+  std::vector<G> falls[FALL_BUCKETS];
+  for (G& game : lifted) {
+    int bucket = Bench::fallDistance(game) / FALL_BUCKET_ROWS;
+    falls[std::min(bucket, FALL_BUCKETS - 1)].push_back(game);
+  }
+
+  std::vector<G> work;
+  auto copyOf = [&](const std::vector<G>& source) {
+    return [&work, from = &source]() { work = *from; };
+  };
+  auto forEach = [&](void (*op)(G&)) {
+    return [&, op]() {
+      for (G& game : work) {
+        op(game);
+      }
+    };
+  };
+
+  measure("isColliding", games.size(), repetitions, [] {}, [&] {
+    int hits = 0;
+    for (G& game : games) {
+      hits += Bench::collidesBelow(game);
+    }
+    sink = hits;
+  });
+  measure("ghost row", games.size(), repetitions, [] {}, [&] {
+    int rows = 0;
+    for (G& game : games) {
+      rows += Bench::ghostRow(game);
+    }
+    sink = rows;
+  });
+  measure("rotateClockwise", games.size(), repetitions, copyOf(games),
+          forEach(Bench::rotateClockwise));
+  measure("rotateCounterClockwise", games.size(), repetitions, copyOf(games),
+          forEach(Bench::rotateCounterClockwise));
+  const char* clearNames[] = {"", "clearLines (1 line)",
+                              "clearLines (2 lines)", "clearLines (3 lines)",
+                              "clearLines (4 lines)"};
+  for (int lines = 1; lines <= 4; lines++) {
+    measure(clearNames[lines], clears[lines].size(), repetitions,
+            copyOf(clears[lines]), forEach(Bench::clearLines));
+  }
+  measure("dropPiece", lifted.size(), repetitions, copyOf(lifted),
+          forEach(Bench::dropPiece));
+  const char* fallNames[] = {"dropPiece (0-4 rows)", "dropPiece (5-9 rows)",
+                             "dropPiece (10-14 rows)", "dropPiece (15+ rows)"};
+  for (int bucket = 0; bucket < FALL_BUCKETS; bucket++) {
+    measure(fallNames[bucket], falls[bucket].size(), repetitions,
+            copyOf(falls[bucket]), forEach(Bench::dropPiece));
+  }
+  measure("spawnNewPiece", clears[0].size(), repetitions, copyOf(clears[0]),
+          forEach(Bench::spawnNewPiece));
+  // saving a game for undo or search is one copy of its bytes
+  std::vector<G> saved = games;
+  measure("copy game state", games.size(), repetitions, [] {}, [&] {
+    for (size_t i = 0; i < games.size(); i++) {
+      std::memcpy((void*)&saved[i], &games[i], sizeof(G));
+    }
+    sink = saved.back().isOver();
+  });
+}
+
+int main(int argc, char* argv[]) {
+  int repetitions = 25;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.rfind("--repetitions=", 0) == 0) {
+      repetitions = std::max(1, std::atoi(arg.c_str() + 14));
+    } else {
+      files.push_back(arg);
+    }
+  }
+#ifndef NDEBUG
+  std::cout << "built with debug=1, board changes include a full "
+               "consistency scan"
+            << std::endl;
+#endif
+
+  if (files.empty()) {
+    forEachMode([&]<int Mode>() {
+      using G = ModeGame<Mode>;
+      benchGame<G>(GAME_MODES[Mode].name, "generated",
+                   generatePositions<G>(), repetitions);
+    });
+  }
+
+  for (const std::string& file : files) {
+    std::ifstream in(file, std::ios::binary);
+    PositionLogHeader header;
+    if (!in.read((char*)&header, sizeof(header)) ||
+        header.magic != POSITION_LOG_MAGIC ||
+        header.version != POSITION_LOG_VERSION) {
+      std::cout << file << " isn't a position log" << std::endl;
+      continue;
+    }
+    bool found = false;
+    forEachMode([&]<int Mode>() {
+      const GameMode& mode = GAME_MODES[Mode];
+      if (mode.width == header.width && mode.height == header.height) {
+        using G = ModeGame<Mode>;
+        benchGame<G>(mode.name, "recorded", readPositions<G>(in),
+                     repetitions);
+        found = true;
+      }
+    });
+    if (!found) {
+      std::cout << file << " is for a " << header.width << "x"
+                << header.height << " board, which no mode has" << std::endl;
+    }
+  }
+  return 0;
+}
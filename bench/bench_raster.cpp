@@ -0,0 +1,79 @@
+// Replays frames recorded with `tetris --dump-commands=FILE` through SDL's
+// software renderer, once with the SDL_RenderGeometry backend and once with
+// the CPU rasterizer, and reports the time per frame of each. Needs no
+// display or GPU.
+//
+//   bench_raster FILE [repeats]
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "../game_clock.h"
+#include "../render_backend.h"
+#include "../render_commands.h"
+#include "offscreen.h"
+
+// Milliseconds per frame for every frame of every repeat
+std::vector<double> timeBackend(SDL_Renderer* renderer,
+                                CommandBackend& backend,
+                                const std::vector<CommandList>& frames,
+                                int repeats) {
+  std::vector<double> times;
+  for (int i = 0; i < repeats; i++) {
+    for (const CommandList& frame : frames) {
+      uint64_t start = nowMicros();
+      backend.submit(renderer, frame);
+      SDL_RenderPresent(renderer);
+      times.push_back((nowMicros() - start) / 1000.0);
+    }
+  }
+  return times;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cout << "usage: bench_raster FILE [repeats]" << std::endl;
+    return 1;
+  }
+  int repeats = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+
+  Offscreen offscreen;
+  if (!offscreen.open(std::cout)) {
+    return 1;
+  }
+
+  std::ifstream in(argv[1], std::ios::binary);
+  std::vector<CommandList> frames;
+  CommandList frame;
+  while (frame.load(in)) {
+    frames.push_back(frame);
+  }
+  if (frames.empty()) {
+    std::cout << "no frames in " << argv[1] << std::endl;
+    return 1;
+  }
+  std::cout << frames.size() << " frames, " << repeats << " repeats"
+            << std::endl;
+
+  for (CommandBackend* backend : offscreen.backends()) {
+    // one untimed pass to warm caches and create textures
+    timeBackend(offscreen.renderer, *backend, frames, 1);
+    std::vector<double> times =
+        timeBackend(offscreen.renderer, *backend, frames, repeats);
+    std::sort(times.begin(), times.end());
+    double total = 0;
+    for (double time : times) {
+      total += time;
+    }
+    std::cout << backend->name() << ": avg " << total / times.size()
+              << " ms, median " << times[times.size() / 2] << " ms, worst "
+              << times.back() << " ms, " << backend->drawCalls
+              << " draw calls per frame" << std::endl;
+  }
+
+  return 0;
+}
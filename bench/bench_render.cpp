@@ -0,0 +1,114 @@
+// Times drawing every board in the corpus, end to end and one section at a
+// time, with each render backend on an offscreen software renderer. Prints
+// JSON so runs on different commits can be diffed or plotted.
+//
+//   bench_render [repeats] > render.json
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../game_clock.h"
+#include "../render_backend.h"
+#include "../render_commands.h"
+#include "../tetris.h"
+#include "board_corpus.h"
+#include "offscreen.h"
+const int WARMUP = 5;
+
+const char* SECTION_NAMES[] = {"grid", "piece", "ghost", "hold_next", "text"};
+
+struct Timing {
+  double medianMs;
+  double meanMs;
+  double minMs;
+  size_t commands;
+  int drawCalls;
+  int textureSwitches;
+};
+
+// Records and submits one frame `repeats` times after a warmup. Includes
+// clearing the frame, so a section's time is on top of an empty frame's.
+Timing timeFrame(SDL_Renderer* renderer,
+                 CommandBackend& backend,
+                 const std::function<void(CommandList&)>& record,
+                 int repeats) {
+  CommandList commands;
+  std::vector<double> times;
+  for (int i = 0; i < WARMUP + repeats; i++) {
+    uint64_t start = nowMicros();
+    record(commands);
+    backend.submit(renderer, commands);
+    SDL_RenderFlush(renderer);
+    if (i >= WARMUP) {
+      times.push_back((nowMicros() - start) / 1000.0);
+    }
+  }
+  std::sort(times.begin(), times.end());
+  double total = 0;
+  for (double time : times) {
+    total += time;
+  }
+  return {times[times.size() / 2], total / times.size(), times.front(),
+          commands.commands.size(), backend.drawCalls,
+          backend.textureSwitches};
+}
+
+int main(int argc, char* argv[]) {
+  int repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+
+  // stdout is the JSON
+  Offscreen offscreen;
+  if (!offscreen.open(std::cerr)) {
+    return 1;
+  }
+  SDL_Renderer* renderer = offscreen.renderer;
+  std::vector<BoardCase> boards = corpus::boards();
+
+  std::cout << "{\n  \"repeats\": " << repeats << ",\n  \"results\": [";
+  bool first = true;
+  for (CommandBackend* backend : offscreen.backends()) {
+    for (const BoardCase& board : boards) {
+      std::vector<std::pair<std::string, Timing>> timings;
+      timings.push_back(
+          {"total", timeFrame(
+                        renderer, *backend,
+                        [&](CommandList& commands) {
+                          renderSnapshot(commands, board.snapshot);
+                        },
+                        repeats)});
+      for (int i = 0; i < (int)RenderSection::Count; i++) {
+        timings.push_back(
+            {SECTION_NAMES[i],
+             timeFrame(renderer, *backend,
+                       [&](CommandList& commands) {
+                         commands.clear({0, 0, 0, 255});
+                         renderSection(commands, board.snapshot,
+                                       (RenderSection)i);
+                       },
+                       repeats)});
+      }
+
+      for (auto& [section, timing] : timings) {
+        std::cout << (first ? "\n" : ",\n") << "    {\"backend\": \""
+                  << backend->name() << "\", \"board\": \"" << board.name
+                  << "\", \"section\": \"" << section
+                  << "\", \"median_ms\": " << timing.medianMs
+                  << ", \"mean_ms\": " << timing.meanMs
+                  << ", \"min_ms\": " << timing.minMs
+                  << ", \"commands\": " << timing.commands
+                  << ", \"draw_calls\": " << timing.drawCalls
+                  << ", \"texture_switches\": " << timing.textureSwitches
+                  << "}";
+        first = false;
+      }
+    }
+  }
+  std::cout << "\n  ]\n}" << std::endl;
+
+  return 0;
+}
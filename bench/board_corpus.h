@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../render_snapshot.h"
+#include "../tetris_game.h"
+
+// Fixed game states for render checks and benchmarks. Built in code rather
+// than recorded, so they're identical on every machine and every commit.
+struct BoardCase {
+  std::string name;
+  RenderSnapshot snapshot;
+};
+
+namespace corpus {
+
+// every case is on the standard board
+const int GRID_WIDTH = GAME_MODES[0].width;
+const int GRID_HEIGHT = GAME_MODES[0].height;
+
+inline RenderSnapshot emptyBoard() {
+  RenderSnapshot snapshot;
+  std::memset(&snapshot, 0, sizeof(snapshot));
+  std::memset(snapshot.grid, -1, sizeof(snapshot.grid));
+  snapshot.width = GRID_WIDTH;
+  snapshot.height = GRID_HEIGHT;
+  snapshot.heldType = -1;
+  snapshot.nextType = 0;
+  snapshot.linesLeft = LINES_LEFT;
+  return snapshot;
+}
+
+inline bool fits(const RenderSnapshot& snapshot, int row, int col) {
+  for (int r = 0; r < snapshot.pieceSize; r++) {
+    for (int c = 0; c < snapshot.pieceSize; c++) {
+      if (!snapshot.piece[r][c]) {
+        continue;
+      }
+      int gr = row + r;
+      int gc = col + c;
+      if (gc < 0 || gc >= GRID_WIDTH || gr >= GRID_HEIGHT ||
+          (gr >= 0 && snapshot.grid[gr][gc] >= 0)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Puts a piece of `type` at (row, col) in spawn rotation, with its ghost
+inline void placePiece(RenderSnapshot& snapshot, int type, int row, int col) {
+  const PieceShape& shape = PIECE_SHAPES[type][0];
+  std::memset(snapshot.piece, 0, sizeof(snapshot.piece));
+  for (int r = 0; r < shape.size; r++) {
+    for (int c = 0; c < shape.size; c++) {
+      snapshot.piece[r][c] = shape.rows[r] >> c & 1;
+    }
+  }
+  snapshot.pieceSize = shape.size;
+  snapshot.pieceType = type;
+  snapshot.pieceRow = row;
+  snapshot.pieceCol = col;
+  int ghostRow = row;
+  while (fits(snapshot, ghostRow + 1, col)) {
+    ghostRow++;
+  }
+  snapshot.ghostRow = ghostRow;
+}
+
+inline std::vector<BoardCase> boards() {
+  std::vector<BoardCase> cases;
+
+  RenderSnapshot empty = emptyBoard();
+  placePiece(empty, 2, 0, 3);
+  cases.push_back({"empty", empty});
+
+  // bottom half stacked with one hole per row, something held
+  RenderSnapshot half = emptyBoard();
+  for (int r = GRID_HEIGHT / 2; r < GRID_HEIGHT; r++) {
+    for (int c = 0; c < GRID_WIDTH; c++) {
+      if (c != (r * 3) % GRID_WIDTH) {
+        half.grid[r][c] = (r + c) % 7;
+      }
+    }
+  }
+  placePiece(half, 3, 2, 4);
+  half.heldType = 0;
+  half.nextType = 5;
+  half.linesLeft = 23;
+  half.elapsedMs = 61234;
+  cases.push_back({"half", half});
+
+  // every other cell filled, alternating fills and outlines everywhere
+  RenderSnapshot checkerboard = emptyBoard();
+  for (int r = 4; r < GRID_HEIGHT; r++) {
+    for (int c = 0; c < GRID_WIDTH; c++) {
+      if ((r + c) % 2 == 0) {
+        checkerboard.grid[r][c] = (r * GRID_WIDTH + c) % 7;
+      }
+    }
+  }
+  placePiece(checkerboard, 0, 0, 3);
+  checkerboard.heldType = 1;
+  checkerboard.nextType = 6;
+  checkerboard.linesLeft = 7;
+  checkerboard.elapsedMs = 599999;
+  cases.push_back({"checkerboard", checkerboard});
+
+  // topped out, the whole board greyed
+  RenderSnapshot gameOver = half;
+  for (int r = 1; r < GRID_HEIGHT / 2; r++) {
+    for (int c = 0; c < GRID_WIDTH; c++) {
+      if (c != (r * 7) % GRID_WIDTH) {
+        gameOver.grid[r][c] = (r + 2 * c) % 7;
+      }
+    }
+  }
+  gameOver.gameOver = true;
+  std::snprintf(gameOver.gameOverText, sizeof(gameOver.gameOverText), "%s",
+                "GAME OVER - Press R to restart");
+  cases.push_back({"game_over", gameOver});
+
+  // the longest text the game draws, and the widest timer
+  RenderSnapshot longText = emptyBoard();
+  longText.gameOver = true;
+  longText.linesLeft = 0;
+  longText.elapsedMs = 3599990;
+  std::snprintf(longText.gameOverText, sizeof(longText.gameOverText), "%s",
+                "YOU WIN! - Press R to restart");
+  cases.push_back({"long_text", longText});
+
+  return cases;
+}
+
+}  // namespace corpus
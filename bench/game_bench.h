@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../disk_cache.h"
+#include "../tetris_game.h"
+
+// Reaches into a TetrisGame instantiation for the operations that aren't
+// public, for bench_core and replay_check
+template <typename G>
+struct TetrisGameBench {
+  static bool collidesBelow(G& game) {
+    return game.isColliding(game.curRotation, game.curR + 1, game.curC);
+  }
+  // the landing row is cached, so drop the cache to time working it out
+  static int ghostRow(G& game) {
+    game.landingValid = false;
+    return game.landingRow();
+  }
+  static void rotateClockwise(G& game) { game.rotateClockwise(); }
+  static void rotateCounterClockwise(G& game) {
+    game.rotateCounterClockwise();
+  }
+  static void lock(G& game) { game.addCurrentPiece(); }
+  static int fallDistance(G& game) { return game.landingRow() - game.curR; }
+  static void clearLines(G& game) { game.clearLines(); }
+  static void dropPiece(G& game) { game.dropPiece(); }
+  static void spawnNewPiece(G& game) { game.spawnNewPiece(); }
+
+  static int fullRows(const G& game) {
+    int rows = 0;
+    for (int r = 0; r < G::HEIGHT; r++) {
+      rows += game.board.rowFull(r);
+    }
+    return rows;
+  }
+
+  // Lifts the piece to the top of the board when it fits there, so a drop
+  // has somewhere to fall
+  static void liftPiece(G& game) {
+    if (!game.isColliding(game.curRotation, 0, game.curC)) {
+      game.curR = 0;
+    }
+  }
+
+  // The game doesn't handle a piece locking above the board, so start over
+  // before one can
+  static void startOverIfStuck(G& game) {
+    if (game.gameOver || game.curR < 0) {
+      game.reset();
+    }
+  }
+
+  // Makes the move `move` picks, out of the ones a player has
+  static void randomMove(G& game, uint32_t move) {
+    switch (move % 6) {
+      case 0:
+        game.rotateClockwise();
+        break;
+      case 1:
+        game.rotateCounterClockwise();
+        break;
+      case 2:
+        game.moveLeft();
+        break;
+      case 3:
+        game.moveRight();
+        break;
+      case 4:
+        game.progressPieces();
+        break;
+      case 5:
+        game.dropPiece();
+        break;
+    }
+    if (game.curR < 0) {
+      game.reset();
+    }
+  }
+
+  // Folds the board, the pieces and the lock count into `hash`
+  static uint64_t hashState(const G& game, uint64_t hash) {
+    hash = fnv1a(game.board.grid(), sizeof(game.board.grid()), hash);
+    int32_t state[] = {game.curType, game.curRotation, game.curR,
+                       game.curC, game.nextType, game.heldPieceType,
+                       game.linesLeft, (int32_t)game.lockCount};
+    return fnv1a(state, sizeof(state), hash);
+  }
+};
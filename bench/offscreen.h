@@ -0,0 +1,60 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_render.h>
+#include <SDL2/SDL_ttf.h>
+#include <array>
+#include <ostream>
+
+#include "../font_manager.h"
+#include "../render_backend.h"
+#include "../software_backend.h"
+
+// SDL's software renderer drawing into a surface under the dummy video
+// driver, with the fonts loaded and both render backends, so checks and
+// benchmarks need no display or GPU. Everything is torn down with it.
+class Offscreen {
+ public:
+  static constexpr int WIDTH = 1024;
+  static constexpr int HEIGHT = 768;
+
+  SDL_Surface* surface = nullptr;
+  SDL_Renderer* renderer = nullptr;
+  RenderBackend geometry;
+  SoftwareBackend cpu;
+
+  // Prints why to `errors` and returns false if SDL couldn't be set up
+  bool open(std::ostream& errors) {
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    if (SDL_Init(SDL_INIT_VIDEO) < 0 || TTF_Init() == -1) {
+      errors << "could not init: " << SDL_GetError() << std::endl;
+      return false;
+    }
+    surface = SDL_CreateRGBSurfaceWithFormat(0, WIDTH, HEIGHT, 32,
+                                             SDL_PIXELFORMAT_ARGB8888);
+    renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    if (!renderer) {
+      errors << "could not create renderer: " << SDL_GetError() << std::endl;
+      return false;
+    }
+    // registers the atlases in the same order as the game, so texture ids
+    // in a command dump line up
+    FontManager::getInstance().initialize(renderer);
+    return true;
+  }
+
+  // The backends in the order results are reported
+  std::array<CommandBackend*, 2> backends() {
+    return {&geometry, &cpu};
+  }
+
+  ~Offscreen() {
+    cpu.release();
+    if (renderer) {
+      SDL_DestroyRenderer(renderer);
+    }
+    SDL_FreeSurface(surface);
+    TTF_Quit();
+    SDL_Quit();
+  }
+};
@@ -0,0 +1,161 @@
+// Renders the menu and every board in the corpus offscreen, on SDL's
+// software renderer under the dummy video driver, with each backend. In
+// record mode the frames are saved as golden BMPs; in compare mode they are
+// checked against the goldens and the command exits non-zero on any
+// difference. Both modes time every render.
+//
+// Pixels count as equal within TOLERANCE per channel. The goldens in
+// golden/ are tracked; compare after changing the render path, and when the
+// change is intended, record over them and check the new frames by eye:
+//
+//   render_check record [DIR]
+//   render_check compare [DIR]
+
+#include <SDL2/SDL.h>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../game_clock.h"
+#include "../menu.h"
+#include "../render_commands.h"
+#include "../tetris.h"
+#include "board_corpus.h"
+#include "offscreen.h"
+
+const int REPEATS = 20;
+// per channel difference still counted as equal, for rounding in blending
+const int TOLERANCE = 2;
+
+struct RenderCase {
+  std::string name;
+  std::function<void(CommandList&)> record;
+};
+
+std::vector<uint32_t> readPixels(SDL_Renderer* renderer) {
+  std::vector<uint32_t> pixels(Offscreen::WIDTH * Offscreen::HEIGHT);
+  SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888,
+                       pixels.data(), Offscreen::WIDTH * sizeof(uint32_t));
+  return pixels;
+}
+
+bool saveBmp(const std::string& path, std::vector<uint32_t>& pixels) {
+  SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(
+      pixels.data(), Offscreen::WIDTH, Offscreen::HEIGHT, 32,
+      Offscreen::WIDTH * sizeof(uint32_t), SDL_PIXELFORMAT_ARGB8888);
+  bool ok = surface && SDL_SaveBMP(surface, path.c_str()) == 0;
+  SDL_FreeSurface(surface);
+  return ok;
+}
+
+// Pixels further apart than TOLERANCE in any channel, or -1 without a
+// usable golden
+int countDifferences(const std::string& path,
+                     const std::vector<uint32_t>& pixels) {
+  SDL_Surface* loaded = SDL_LoadBMP(path.c_str());
+  if (!loaded) {
+    return -1;
+  }
+  SDL_Surface* golden =
+      SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+  SDL_FreeSurface(loaded);
+  if (!golden || golden->w != Offscreen::WIDTH ||
+      golden->h != Offscreen::HEIGHT) {
+    SDL_FreeSurface(golden);
+    return -1;
+  }
+  int differences = 0;
+  for (int y = 0; y < Offscreen::HEIGHT; y++) {
+    const uint32_t* row =
+        (const uint32_t*)((const uint8_t*)golden->pixels + y * golden->pitch);
+    for (int x = 0; x < Offscreen::WIDTH; x++) {
+      uint32_t a = row[x];
+      uint32_t b = pixels[y * Offscreen::WIDTH + x];
+      for (int shift = 0; shift < 24; shift += 8) {
+        if (std::abs((int)((a >> shift) & 0xff) - (int)((b >> shift) & 0xff)) >
+            TOLERANCE) {
+          differences++;
+          break;
+        }
+      }
+    }
+  }
+  SDL_FreeSurface(golden);
+  return differences;
+}
+
+int main(int argc, char* argv[]) {
+  std::string mode = argc > 1 ? argv[1] : "compare";
+  std::string dir = argc > 2 ? argv[2] : "golden";
+  if (mode != "record" && mode != "compare") {
+    std::cout << "usage: render_check [record|compare] [DIR]" << std::endl;
+    return 1;
+  }
+
+  Offscreen offscreen;
+  if (!offscreen.open(std::cout)) {
+    return 1;
+  }
+  SDL_Renderer* renderer = offscreen.renderer;
+  if (mode == "record") {
+    std::filesystem::create_directories(dir);
+  }
+
+  SceneManager sceneManager;
+  auto menu = std::make_shared<Menu>(sceneManager);
+  std::vector<RenderCase> cases = {
+      {"menu", [&](CommandList& commands) { menu->render(commands); }}};
+  for (const BoardCase& board : corpus::boards()) {
+    cases.push_back({board.name, [board](CommandList& commands) {
+                       renderSnapshot(commands, board.snapshot);
+                     }});
+  }
+
+  CommandList commands;
+  int failures = 0;
+  for (CommandBackend* backend : offscreen.backends()) {
+    for (const RenderCase& renderCase : cases) {
+      double total = 0;
+      for (int i = 0; i <= REPEATS; i++) {
+        uint64_t start = nowMicros();
+        renderCase.record(commands);
+        backend->submit(renderer, commands);
+        SDL_RenderFlush(renderer);
+        // the first pass only warms up
+        if (i > 0) {
+          total += nowMicros() - start;
+        }
+      }
+
+      std::vector<uint32_t> pixels = readPixels(renderer);
+      std::string path =
+          dir + "/" + renderCase.name + "-" + backend->name() + ".bmp";
+      std::cout << renderCase.name << " (" << backend->name()
+                << "): " << total / REPEATS / 1000 << " ms";
+      if (mode == "record") {
+        if (!saveBmp(path, pixels)) {
+          std::cout << ", could not write " << path;
+          failures++;
+        }
+      } else {
+        int differences = countDifferences(path, pixels);
+        if (differences < 0) {
+          std::cout << ", FAIL: no golden at " << path;
+          failures++;
+        } else if (differences > 0) {
+          std::cout << ", FAIL: " << differences << " pixels differ";
+          failures++;
+        } else {
+          std::cout << ", ok";
+        }
+      }
+      std::cout << std::endl;
+    }
+  }
+
+  return failures == 0 ? 0 : 1;
+}
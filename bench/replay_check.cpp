@@ -0,0 +1,82 @@
+// Checks that the game is deterministic. Every mode plays a long run of
+// random moves from a fixed seed, and the state after each move is hashed:
+// the hash has to match the one recorded below, and every so often the
+// game is copied, played on, rolled back to the copy and played again with
+// the same moves, which has to give the same hashes. A changed hash means
+// the rules changed; when that's intended, put the printed hash in
+// EXPECTED_HASHES.
+//
+//   replay_check
+
+#include <SDL2/SDL.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "../disk_cache.h"
+#include "../tetris_game.h"
+#include "game_bench.h"
+
+const int MOVES = 200000;
+const uint64_t SEED = 7;
+// a rollback every this many moves, replaying ROLLBACK_MOVES of them
+const int ROLLBACK_INTERVAL = 1000;
+const int ROLLBACK_MOVES = 64;
+
+// trace hash of each mode, in GAME_MODES order
+const uint64_t EXPECTED_HASHES[MODE_COUNT] = {
+    0xd2328bc411d48497ull, 0x1b7d44c74a03f2f7ull, 0xa5216921039dbf90ull,
+    0xbfa63bf3c786e1deull};
+
+// Makes the move `move` picks and folds the state after it into `hash`
+template <typename G>
+uint64_t step(G& game, uint32_t move, uint64_t hash) {
+  TetrisGameBench<G>::startOverIfStuck(game);
+  TetrisGameBench<G>::randomMove(game, move);
+  return TetrisGameBench<G>::hashState(game, hash);
+}
+
+// Plays MOVES moves on a new game and returns the trace hash, or 0 when a
+// rollback didn't replay the same
+template <typename G>
+uint64_t play() {
+  G game(SEED);
+  RNG moves;
+  moves.seed(SEED, 1);
+  uint64_t hash = FNV_OFFSET_BASIS;
+  for (int i = 0; i < MOVES; i++) {
+    if (i % ROLLBACK_INTERVAL == 0) {
+      G saved;
+      std::memcpy((void*)&saved, &game, sizeof(G));
+      RNG savedMoves = moves;
+      uint64_t played = hash;
+      for (int j = 0; j < ROLLBACK_MOVES; j++) {
+        played = step(game, moves.next(), played);
+      }
+      std::memcpy((void*)&game, &saved, sizeof(G));
+      moves = savedMoves;
+      uint64_t replayed = hash;
+      for (int j = 0; j < ROLLBACK_MOVES; j++) {
+        replayed = step(game, moves.next(), replayed);
+      }
+      if (replayed != played) {
+        std::printf("  rollback at move %d replayed differently\n", i);
+        return 0;
+      }
+    }
+    hash = step(game, moves.next(), hash);
+  }
+  return hash;
+}
+
+int main(int argc, char* argv[]) {
+  int failures = 0;
+  forEachMode([&]<int Mode>() {
+    uint64_t hash = play<ModeGame<Mode>>();
+    bool ok = hash != 0 && hash == EXPECTED_HASHES[Mode];
+    std::printf("%-10s %016" PRIx64 "  %s\n", GAME_MODES[Mode].name, hash,
+                ok ? "ok" : "FAIL");
+    failures += !ok;
+  });
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <type_traits>
+
+#include "collision_kernels.h"
+
+// The smallest unsigned type with at least `Bits` bits
+template <int Bits>
+using MaskFor = std::conditional_t<
+    Bits <= 16,
+    uint16_t,
+    std::conditional_t<Bits <= 32, uint32_t, uint64_t>>;
+
+// The cells of a board together with bit masks of them kept in step: padded
+// rows for the collision kernels, one mask per column for drops, and every
+// column's height and holes. The size is a template parameter so every
+// loop bound is a constant and the masks are the smallest type that fits.
+template <int Width, int Height>
+class Board {
+ public:
+  using RowMask = MaskFor<BOARD_WALL + Width + BOARD_WALL>;
+  // room for the rows above the board that a landing test can start from
+  using ColumnMask = MaskFor<ROOF + Height>;
+  using Cells = int8_t[Height][Width];
+
+  static const int PADDED_ROWS = ROOF + Height + FLOOR;
+  static const int ROW_BITS = sizeof(RowMask) * 8;
+  static constexpr RowMask BOARD_BITS = ((RowMask(1) << Width) - 1)
+                                        << BOARD_WALL;
+  // a row with nothing in it but the walls either side
+  static constexpr RowMask EMPTY_ROW = RowMask(~BOARD_BITS);
+  static constexpr RowMask FULL_ROW = RowMask(~RowMask(0));
+
+  static_assert(ROW_BITS >= BOARD_WALL + Width + BOARD_WALL,
+                "a piece box past either wall has to fit in a row mask");
+  static_assert(Width >= MAX_PIECE_SIZE, "every piece has to fit across");
+  static_assert(Height < 128, "heights are kept in bytes");
+
+ private:
+  // block type of every cell, -1 when empty
+  Cells cells;
+  // board row r at rows[ROOF + r]
+  RowMask rows[PADDED_ROWS];
+  // bit r of columns[c] is set when cells[r][c] is filled
+  ColumnMask columns[Width];
+  // filled height of each column, and empty cells under that surface
+  int8_t heights[Width];
+  int8_t holes[Width];
+  int16_t totalHoles;
+
+  // Height and holes of one column, straight from its mask
+  void updateColumn(int c) {
+    ColumnMask mask = columns[c];
+    int height = mask ? Height - std::countr_zero(mask) : 0;
+    int columnHoles = height - std::popcount(mask);
+    totalHoles += columnHoles - holes[c];
+    heights[c] = height;
+    holes[c] = columnHoles;
+  }
+
+  void rebuild() {
+    for (int r = 0; r < PADDED_ROWS; r++) {
+      int gr = r - ROOF;
+      rows[r] = gr < 0 ? EMPTY_ROW : FULL_ROW;
+      if (gr >= Height) {
+        continue;
+      }
+      for (int c = 0; c < Width && gr >= 0; c++) {
+        if (cells[gr][c] < 0) {
+          rows[r] &= RowMask(~(RowMask(1) << (BOARD_WALL + c)));
+        }
+      }
+    }
+    totalHoles = 0;
+    for (int c = 0; c < Width; c++) {
+      columns[c] = 0;
+      for (int r = 0; r < Height; r++) {
+        if (cells[r][c] >= 0) {
+          columns[c] |= ColumnMask(1) << r;
+        }
+      }
+      holes[c] = 0;
+      updateColumn(c);
+    }
+  }
+
+ public:
+  Board() { clear(); }
+
+  void clear() {
+    std::memset(cells, -1, sizeof(cells));
+    rebuild();
+  }
+
+  void load(const Cells& from) {
+    std::memcpy(cells, from, sizeof(cells));
+    rebuild();
+  }
+
+  const Cells& grid() const { return cells; }
+
+  int columnHeight(int c) const { return heights[c]; }
+  int columnHoleCount(int c) const { return holes[c]; }
+  int holeCount() const { return totalHoles; }
+  bool rowFull(int r) const { return rows[ROOF + r] == FULL_ROW; }
+
+  // One AND per piece row in the kernel for the piece and rotation. A box
+  // outside the padding is past a wall or the floor, or too far above the
+  // board to be a real position, so it always collides.
+  bool collides(int type, int rotation, int row, int col) const {
+    int top = ROOF + row;
+    int shift = BOARD_WALL + col;
+    if ((unsigned)top > PADDED_ROWS - MAX_PIECE_SIZE ||
+        (unsigned)shift > ROW_BITS - MAX_PIECE_SIZE) {
+      return true;
+    }
+    return COLLISION_KERNELS<RowMask>[type * ROTATIONS + rotation](
+        rows + top, shift);
+  }
+
+  // Quick test for a freshly spawned piece: it can't collide if every
+  // column it covers is filled only below its lowest block there. When
+  // that fails collides() still has to decide.
+  bool fitsAboveStack(int type, int rotation, int row, int col) const {
+    const PieceShape& shape = PIECE_SHAPES[type][rotation];
+    for (int c = 0; c < MAX_PIECE_SIZE; c++) {
+      if (shape.bottoms[c] < 0) {
+        continue;
+      }
+      int column = col + c;
+      if (column < 0 || column >= Width ||
+          Height - heights[column] <= row + shape.bottoms[c]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Each piece column falls until the first filled cell below its lowest
+  // block, found with one shift and count of the column mask. No tetromino
+  // has a gap inside a column, so the lowest block is the only one to check.
+  // A box can start up to ROOF rows above the board, so the fall is capped
+  // at ROOF + Height rather than Height.
+  int landingRow(int type, int rotation, int row, int col) const {
+    const PieceShape& shape = PIECE_SHAPES[type][rotation];
+    int fall = ROOF + Height;
+    for (int c = 0; c < MAX_PIECE_SIZE; c++) {
+      if (shape.bottoms[c] < 0) {
+        continue;
+      }
+      ColumnMask mask = columns[col + c];
+      int start = row + shape.bottoms[c] + 1;
+      // rows above the board count as empty
+      ColumnMask below = start >= 0 ? mask >> start : mask << -start;
+      int distance = below ? std::countr_zero(below) : Height - start;
+      fall = std::min(fall, distance);
+    }
+    checkLanding(type, rotation, row, col, row + fall);
+    return row + fall;
+  }
+
+  void place(int type, int rotation, int row, int col) {
+    const PieceShape& shape = PIECE_SHAPES[type][rotation];
+    for (int r = 0; r < shape.size; r++) {
+      for (int c = 0; c < shape.size; c++) {
+        if (shape.rows[r] >> c & 1) {
+          cells[row + r][col + c] = type;
+          rows[ROOF + row + r] |= RowMask(1) << (BOARD_WALL + col + c);
+          columns[col + c] |= ColumnMask(1) << (row + r);
+        }
+      }
+    }
+    for (int c = 0; c < MAX_PIECE_SIZE; c++) {
+      if (shape.bottoms[c] >= 0) {
+        updateColumn(col + c);
+      }
+    }
+    check();
+  }
+
+  // Clears the lowest full row and then each full row that moves down into
+  // its place, and returns how many went
+  int clearLines() {
+    int lowestFullRow = -1;
+    for (int r = Height - 1; r >= 0; r--) {
+      if (rowFull(r)) {
+        lowestFullRow = r;
+        break;
+      }
+    }
+    if (lowestFullRow < 0) {
+      return 0;
+    }
+
+    int cleared = 0;
+    // the same shift on the column masks: rows above the cleared one move
+    // down and the cleared one drops out
+    ColumnMask above = (ColumnMask(1) << lowestFullRow) - 1;
+    ColumnMask keep = ~(above | (ColumnMask(1) << lowestFullRow));
+    while (rowFull(lowestFullRow)) {
+      for (int nr = lowestFullRow; nr > 0; nr--) {
+        std::memcpy(cells[nr], cells[nr - 1], sizeof(cells[nr]));
+        rows[ROOF + nr] = rows[ROOF + nr - 1];
+      }
+      std::memset(cells[0], -1, sizeof(cells[0]));
+      rows[ROOF] = EMPTY_ROW;
+      for (int c = 0; c < Width; c++) {
+        columns[c] = (columns[c] & keep) | ((columns[c] & above) << 1);
+        updateColumn(c);
+      }
+      cleared++;
+    }
+    check();
+    return cleared;
+  }
+
+  // Compares the masks and column counts with a full scan of the cells.
+  // Only in debug builds, where a mismatch means a missed update somewhere.
+  void check() const {
+#ifndef NDEBUG
+    for (int r = 0; r < Height; r++) {
+      RowMask row = EMPTY_ROW;
+      for (int c = 0; c < Width; c++) {
+        if (cells[r][c] >= 0) {
+          row |= RowMask(1) << (BOARD_WALL + c);
+        }
+      }
+      if (row != rows[ROOF + r]) {
+        std::cout << "row " << r << " out of sync with the grid" << std::endl;
+        throw std::exception();
+      }
+    }
+    int allHoles = 0;
+    for (int c = 0; c < Width; c++) {
+      ColumnMask mask = 0;
+      int height = 0;
+      int columnHoles = 0;
+      for (int r = Height - 1; r >= 0; r--) {
+        if (cells[r][c] >= 0) {
+          mask |= ColumnMask(1) << r;
+          columnHoles += Height - r - 1 - height;
+          height = Height - r;
+        }
+      }
+      allHoles += columnHoles;
+      if (mask != columns[c] || height != heights[c] ||
+          columnHoles != holes[c]) {
+        std::cout << "column " << c << " out of sync with the grid"
+                  << std::endl;
+        throw std::exception();
+      }
+    }
+    if (allHoles != totalHoles) {
+      std::cout << "hole count out of sync with the grid" << std::endl;
+      throw std::exception();
+    }
+#endif
+  }
+
+  // Compares a landing row with stepping the piece down one row at a time.
+  // Only in debug builds, like check().
+  void checkLanding(int type,
+                    int rotation,
+                    int row,
+                    int col,
+                    int landing) const {
+#ifndef NDEBUG
+    if (collides(type, rotation, row, col)) {
+      return;
+    }
+    int stepped = row;
+    while (!collides(type, rotation, stepped + 1, col)) {
+      stepped++;
+    }
+    if (stepped != landing) {
+      std::cout << "landing row " << landing << " should be " << stepped
+                << std::endl;
+      throw std::exception();
+    }
+#endif
+  }
+};
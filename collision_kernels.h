@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "render_snapshot.h"
+
+const int PIECE_TYPES = 7;
+const int ROTATIONS = 4;
+
+static_assert(MAX_PIECE_SIZE == 4, "kernels test four piece rows");
+
+// One bit per block, bit c of rows[r] for column c of the piece's box
+struct PieceShape {
+  int size;
+  uint8_t rows[MAX_PIECE_SIZE];
+  // lowest block of each column of the box, -1 for empty columns
+  int8_t bottoms[MAX_PIECE_SIZE];
+};
+
+// Spawn orientations: I, O, T, L, J, S, Z
+constexpr PieceShape SHAPES[PIECE_TYPES] = {
+    {4, {0b0000, 0b1111, 0b0000, 0b0000}},  // I
+    {2, {0b11, 0b11}},                      // O
+    {3, {0b010, 0b111, 0b000}},             // T
+    {3, {0b100, 0b111, 0b000}},             // L
+    {3, {0b001, 0b111, 0b000}},             // J
+    {3, {0b110, 0b011, 0b000}},             // S
+    {3, {0b011, 0b110, 0b000}}};            // Z
+
+// A clockwise turn inside the box, the same one rotateClockwise makes
+constexpr PieceShape turnClockwise(PieceShape shape) {
+  PieceShape turned{shape.size, {}};
+  for (int r = 0; r < shape.size; r++) {
+    for (int c = 0; c < shape.size; c++) {
+      if (shape.rows[r] >> c & 1) {
+        turned.rows[c] |= 1 << (shape.size - 1 - r);
+      }
+    }
+  }
+  return turned;
+}
+
+constexpr PieceShape pieceShape(int type, int rotation) {
+  PieceShape shape = SHAPES[type];
+  for (int i = 0; i < rotation; i++) {
+    shape = turnClockwise(shape);
+  }
+  for (int c = 0; c < MAX_PIECE_SIZE; c++) {
+    shape.bottoms[c] = -1;
+    for (int r = 0; r < shape.size; r++) {
+      if (shape.rows[r] >> c & 1) {
+        shape.bottoms[c] = r;
+      }
+    }
+  }
+  return shape;
+}
+
+// Every piece type in every rotation
+constexpr std::array<std::array<PieceShape, ROTATIONS>, PIECE_TYPES>
+    PIECE_SHAPES = [] {
+      std::array<std::array<PieceShape, ROTATIONS>, PIECE_TYPES> shapes{};
+      for (int type = 0; type < PIECE_TYPES; type++) {
+        for (int rotation = 0; rotation < ROTATIONS; rotation++) {
+          shapes[type][rotation] = pieceShape(type, rotation);
+        }
+      }
+      return shapes;
+    }();
+
+// Board rows for collision tests are bit masks with column c at bit
+// BOARD_WALL + c and every bit outside the board set, so walls are just
+// more filled cells. ROOF empty rows sit above the board and FLOOR full
+// rows below it, so a piece box anywhere from ROOF rows above the board
+// down to the floor reads real rows. A box further left than BOARD_WALL
+// columns past the wall has every block in the wall, and one further right
+// than the last column has every block past it.
+const int BOARD_WALL = MAX_PIECE_SIZE - 1;
+const int ROOF = MAX_PIECE_SIZE;
+const int FLOOR = MAX_PIECE_SIZE - 1;
+
+// The blocks of one piece row that overlap the board row, skipped at
+// compile time for empty piece rows
+template <typename Mask, int Type, int Rotation, int Row>
+inline Mask rowOverlap(const Mask* rows, int shift) {
+  constexpr Mask bits = PIECE_SHAPES[Type][Rotation].rows[Row];
+  if constexpr (bits == 0) {
+    return 0;
+  } else {
+    return rows[Row] & Mask(bits << shift);
+  }
+}
+
+// Whether a piece collides with `rows`, the board rows starting at the top
+// of its box. `shift` is the box's column plus BOARD_WALL.
+template <typename Mask, int Type, int Rotation>
+bool collides(const Mask* rows, int shift) {
+  return (rowOverlap<Mask, Type, Rotation, 0>(rows, shift) |
+          rowOverlap<Mask, Type, Rotation, 1>(rows, shift) |
+          rowOverlap<Mask, Type, Rotation, 2>(rows, shift) |
+          rowOverlap<Mask, Type, Rotation, 3>(rows, shift)) != 0;
+}
+
+template <typename Mask>
+using CollisionKernel = bool (*)(const Mask* rows, int shift);
+
+template <typename Mask, std::size_t... I>
+constexpr std::array<CollisionKernel<Mask>, sizeof...(I)> makeKernels(
+    std::index_sequence<I...>) {
+  return {collides<Mask, I / ROTATIONS, I % ROTATIONS>...};
+}
+
+// Kernel for each piece type and rotation, at type * ROTATIONS + rotation,
+// for boards whose rows are `Mask`s
+template <typename Mask>
+constexpr std::array<CollisionKernel<Mask>, PIECE_TYPES * ROTATIONS>
+    COLLISION_KERNELS =
+        makeKernels<Mask>(std::make_index_sequence<PIECE_TYPES * ROTATIONS>());
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+#include "mapped_file.h"
+
+// Small binary caches of derived asset data (rasterized fonts, decoded
+// audio). Every file starts with a CacheHeader whose key covers everything
+// the payload was derived from; a key or version mismatch means stale.
+
+// kept next to the assets, so it's the same whatever the working directory
+const char* const CACHE_DIR = "cache";
+const uint32_t CACHE_MAGIC = 0x48434354;  // "TCCH"
+const uint32_t CACHE_VERSION = 1;
+// Payloads start aligned so mapped pixel and sample data can be handed
+// straight to SDL.
+const uint32_t CACHE_PAYLOAD_ALIGN = 16;
+
+struct CacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint64_t payloadSize;
+  uint32_t payloadOffset;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(CacheHeader) % CACHE_PAYLOAD_ALIGN == 0);
+
+const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+
+inline uint64_t fnv1a(const void* data,
+                      size_t size,
+                      uint64_t hash = FNV_OFFSET_BASIS) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+template <typename T>
+uint64_t fnv1aValue(const T& value, uint64_t hash) {
+  return fnv1a(&value, sizeof(T), hash);
+}
+
+inline std::string cachePath(const std::string& name) {
+  return (AssetPack::getInstance().directory() / CACHE_DIR / name).string();
+}
+
+// Maps a cache file and returns it only if it was written for `key`.
+inline std::optional<MappedFile> openCacheFile(const std::string& path,
+                                               uint64_t key) {
+  MappedFile file(path);
+  if (!file.valid() || file.size() < sizeof(CacheHeader)) {
+    return std::nullopt;
+  }
+  CacheHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+      header.key != key || header.payloadOffset > file.size() ||
+      header.payloadSize > file.size() - header.payloadOffset) {
+    return std::nullopt;
+  }
+  return file;
+}
+
+inline const uint8_t* cachePayload(const MappedFile& file) {
+  CacheHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  return file.data() + header.payloadOffset;
+}
+
+inline uint64_t cachePayloadSize(const MappedFile& file) {
+  CacheHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  return header.payloadSize;
+}
+
+// Writes the payload pieces back to back. Failing to write a cache is never
+// fatal, the data just gets rebuilt next launch.
+inline bool writeCacheFile(
+    const std::string& path,
+    uint64_t key,
+    const std::vector<std::pair<const void*, size_t>>& pieces) {
+  std::error_code error;
+  std::filesystem::create_directories(
+      std::filesystem::path(path).parent_path(), error);
+
+  CacheHeader header = {};
+  header.magic = CACHE_MAGIC;
+  header.version = CACHE_VERSION;
+  header.key = key;
+  header.payloadOffset = sizeof(CacheHeader);
+  for (auto& piece : pieces) {
+    header.payloadSize += piece.second;
+  }
+
+  // write to a temporary name first so a crash never leaves a torn cache
+  std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (auto& piece : pieces) {
+      out.write(static_cast<const char*>(piece.first), piece.second);
+    }
+    if (!out) {
+      return false;
+    }
+  }
+  std::filesystem::rename(tmpPath, path, error);
+  return !error;
+}
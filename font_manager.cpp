@@ -2,54 +2,250 @@
 #include <SDL2/SDL_render.h>
 #include <SDL2/SDL_surface.h>
 #include <SDL2/SDL_ttf.h>
+#include <algorithm>
+#include <cstring>
 #include <exception>
+#include <filesystem>
 #include <iostream>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "asset_pack.h"
+#include "disk_cache.h"
 #include "font_manager.h"
+#include "texture_registry.h"
 
 const std::vector<std::tuple<std::string, int>> fontLocations = {
-    {"assets/open_sans.ttf", 24},
-    {"assets/roboto.ttf", 36}};
+    {"open_sans.ttf", 24},
+    {"roboto.ttf", 36}};
+
+const int ATLAS_WIDTH = 1024;
+
+// Layout of an .atlas cache payload: AtlasInfo, then the glyph rects, then
+// height * pitch bytes of pixels already in the renderer's texture format.
+struct AtlasInfo {
+  uint32_t format;
+  int32_t width;
+  int32_t height;
+  int32_t pitch;
+};
+
+// Whether an atlas read from a cache has 32-bit pixels, a sane size with
+// its pixels all within `pixelBytes`, and every glyph inside it
+bool validAtlas(const AtlasInfo& info,
+                const std::array<GlyphRect, GLYPH_COUNT>& glyphs,
+                uint64_t pixelBytes) {
+  if (SDL_BYTESPERPIXEL(info.format) != 4 || info.width <= 0 ||
+      info.width > ATLAS_WIDTH || info.height <= 0 ||
+      info.height > ATLAS_WIDTH || info.pitch < info.width * 4 ||
+      info.pitch % 4 != 0 ||
+      (uint64_t)info.height * info.pitch > pixelBytes) {
+    return false;
+  }
+  for (const GlyphRect& glyph : glyphs) {
+    if (glyph.x < 0 || glyph.y < 0 || glyph.w < 0 || glyph.h < 0 ||
+        glyph.x + glyph.w > info.width ||
+        (glyph.w > 0 && glyph.y + glyph.h > info.height)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The texture format the renderer would pick anyway, so uploads from the
+// cache need no conversion
+uint32_t preferredTextureFormat(SDL_Renderer* renderer) {
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(renderer, &info) == 0) {
+    for (Uint32 i = 0; i < info.num_texture_formats; i++) {
+      uint32_t format = info.texture_formats[i];
+      if (SDL_BITSPERPIXEL(format) == 32 && SDL_ISPIXELFORMAT_ALPHA(format)) {
+        return format;
+      }
+    }
+  }
+  return SDL_PIXELFORMAT_ARGB8888;
+}
 
 void FontManager::initialize(SDL_Renderer* p_renderer) {
   renderer = p_renderer;
+  uint32_t format = preferredTextureFormat(renderer);
   for (auto& pair : fontLocations) {
-    auto& location = std::get<0>(pair);
+    auto& name = std::get<0>(pair);
     auto& size = std::get<1>(pair);
-    TTF_Font* font = TTF_OpenFont(location.c_str(), size);
-    if (!font) {
+
+    AssetData fontFile = AssetPack::getInstance().get(name);
+    if (!fontFile.data) {
       throw std::exception();
     }
-    SDL_Color white = {255, 255, 255, 255};
-    std::unordered_map<char, SDL_Texture*> font_map;
-    for (uint8_t c = 0; c <= 127; c++) {
-      char str[2] = {(char)c, '\0'};
-      SDL_Surface* surface = TTF_RenderText_Blended(font, str, white);
-      SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-      font_map[c] = texture;
-      SDL_FreeSurface(surface);
+    uint64_t key = fnv1a(fontFile.data, fontFile.size);
+    key = fnv1aValue(size, key);
+    key = fnv1aValue(format, key);
+
+    std::string path =
+        cachePath(std::filesystem::path(name).stem().string() + "-" +
+                  std::to_string(size) + ".atlas");
+
+    FontAtlas atlas;
+    if (!loadCachedAtlas(path, key, atlas)) {
+      rasterizeAtlas(name, size, format, path, key, atlas);
     }
-    font_to_cache.push_back({font, font_map});
+    SDL_SetTextureBlendMode(atlas.texture, SDL_BLENDMODE_BLEND);
+    atlas.textureId = TextureRegistry::getInstance().add(atlas.texture);
+    atlases.push_back(atlas);
   }
 };
 
+bool FontManager::loadCachedAtlas(const std::string& path,
+                                  uint64_t key,
+                                  FontAtlas& atlas) {
+  auto file = openCacheFile(path, key);
+  if (!file) {
+    return false;
+  }
+  const uint8_t* payload = cachePayload(*file);
+  uint64_t payloadSize = cachePayloadSize(*file);
+  if (payloadSize < sizeof(AtlasInfo) + sizeof(atlas.glyphs)) {
+    return false;
+  }
+  AtlasInfo info;
+  std::memcpy(&info, payload, sizeof(info));
+  payload += sizeof(info);
+  std::memcpy(atlas.glyphs.data(), payload, sizeof(atlas.glyphs));
+  payload += sizeof(atlas.glyphs);
+  // a file whose key matches can still be truncated or corrupt, so check
+  // everything the pixels and glyphs are read with before using them
+  if (!validAtlas(info, atlas.glyphs,
+                  payloadSize - sizeof(info) - sizeof(atlas.glyphs))) {
+    std::cout << "ignoring corrupt font cache " << path << std::endl;
+    return false;
+  }
+
+  atlas.texture = SDL_CreateTexture(renderer, info.format,
+                                    SDL_TEXTUREACCESS_STATIC, info.width,
+                                    info.height);
+  if (!atlas.texture) {
+    return false;
+  }
+  if (SDL_UpdateTexture(atlas.texture, NULL, payload, info.pitch) != 0) {
+    SDL_DestroyTexture(atlas.texture);
+    atlas.texture = nullptr;
+    return false;
+  }
+  keepCoverage(atlas, payload, info.pitch, info.width, info.height,
+               info.format);
+  return true;
+}
+
+void FontManager::keepCoverage(FontAtlas& atlas,
+                               const uint8_t* pixels,
+                               int pitch,
+                               int width,
+                               int height,
+                               uint32_t format) {
+  int bpp;
+  Uint32 rMask, gMask, bMask, aMask;
+  SDL_PixelFormatEnumToMasks(format, &bpp, &rMask, &gMask, &bMask, &aMask);
+  int shift = 0;
+  while (aMask && !(aMask & (1u << shift))) {
+    shift++;
+  }
+
+  atlas.width = width;
+  atlas.coverage.resize((size_t)width * height);
+  for (int y = 0; y < height; y++) {
+    const uint32_t* row = (const uint32_t*)(pixels + (size_t)y * pitch);
+    for (int x = 0; x < width; x++) {
+      atlas.coverage[(size_t)y * width + x] = (row[x] & aMask) >> shift;
+    }
+  }
+}
+
+void FontManager::rasterizeAtlas(const std::string& name,
+                                 int size,
+                                 uint32_t format,
+                                 const std::string& path,
+                                 uint64_t key,
+                                 FontAtlas& atlas) {
+  TTF_Font* font =
+      TTF_OpenFontRW(AssetPack::getInstance().open(name), 1, size);
+  if (!font) {
+    throw std::exception();
+  }
+
+  SDL_Color white = {255, 255, 255, 255};
+  std::vector<SDL_Surface*> surfaces(GLYPH_COUNT, nullptr);
+  int x = 0;
+  int y = 0;
+  int rowHeight = 0;
+  for (int c = 0; c < GLYPH_COUNT; c++) {
+    char str[2] = {(char)c, '\0'};
+    SDL_Surface* surface = TTF_RenderText_Blended(font, str, white);
+    surfaces[c] = surface;
+    if (!surface) {
+      // nothing to draw, but newlines still need the line height
+      atlas.glyphs[c] = {0, 0, 0, (int16_t)TTF_FontHeight(font)};
+      continue;
+    }
+    if (x + surface->w > ATLAS_WIDTH) {
+      x = 0;
+      y += rowHeight;
+      rowHeight = 0;
+    }
+    atlas.glyphs[c] = {(int16_t)x, (int16_t)y, (int16_t)surface->w,
+                       (int16_t)surface->h};
+    x += surface->w;
+    rowHeight = std::max(rowHeight, surface->h);
+  }
+  TTF_CloseFont(font);
+
+  SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(
+      0, ATLAS_WIDTH, y + rowHeight, SDL_BITSPERPIXEL(format), format);
+  if (!sheet) {
+    throw std::exception();
+  }
+  SDL_FillRect(sheet, NULL, SDL_MapRGBA(sheet->format, 255, 255, 255, 0));
+  for (int c = 0; c < GLYPH_COUNT; c++) {
+    if (!surfaces[c]) {
+      continue;
+    }
+    // copy the glyph's alpha as is instead of blending onto the sheet
+    SDL_SetSurfaceBlendMode(surfaces[c], SDL_BLENDMODE_NONE);
+    SDL_Rect dst = {atlas.glyphs[c].x, atlas.glyphs[c].y, atlas.glyphs[c].w,
+                    atlas.glyphs[c].h};
+    SDL_BlitSurface(surfaces[c], NULL, sheet, &dst);
+    SDL_FreeSurface(surfaces[c]);
+  }
+
+  atlas.texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STATIC,
+                                    sheet->w, sheet->h);
+  if (!atlas.texture) {
+    throw std::exception();
+  }
+  SDL_UpdateTexture(atlas.texture, NULL, sheet->pixels, sheet->pitch);
+  keepCoverage(atlas, (const uint8_t*)sheet->pixels, sheet->pitch, sheet->w,
+               sheet->h, format);
+
+  AtlasInfo info = {format, sheet->w, sheet->h, sheet->pitch};
+  writeCacheFile(path, key,
+                 {{&info, sizeof(info)},
+                  {atlas.glyphs.data(), sizeof(atlas.glyphs)},
+                  {sheet->pixels, (size_t)sheet->h * sheet->pitch}});
+  SDL_FreeSurface(sheet);
+}
+
 std::pair<int, int> FontManager::getTextSize(std::string text, int font) {
   int x = 0;
   int y = 0;
   for (char c : text) {
-    SDL_Texture* texture = std::get<1>(font_to_cache.at(font))[c];
-    int w;
-    int h;
-    SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+    const GlyphRect& glyph = atlases.at(font).glyphs[(uint8_t)c % GLYPH_COUNT];
     if (c == '\n') {
-      y += h;
+      y += glyph.h;
     } else {
-      x += w;
+      x += glyph.w;
       if (y == 0) {
-        y += h;
+        y += glyph.h;
       }
     }
   }
@@ -57,21 +253,10 @@ std::pair<int, int> FontManager::getTextSize(std::string text, int font) {
   return {x, y};
 }
 
-void FontManager::renderText(int x, int y, std::string text, int font) {
-  int startingX = x;
-  int startingY = y;
-  for (char c : text) {
-    SDL_Texture* texture = std::get<1>(font_to_cache.at(font))[c];
-    int w;
-    int h;
-    SDL_QueryTexture(texture, NULL, NULL, &w, &h);
-    if (c == '\n') {
-      startingY += h;
-      startingX = x;
-    } else {
-      SDL_Rect rect = {startingX, startingY, w, h};
-      SDL_RenderCopy(renderer, texture, NULL, &rect);
-      startingX += w;
-    }
-  }
-};
+void FontManager::renderText(CommandList& commands,
+                             int x,
+                             int y,
+                             std::string text,
+                             int font) {
+  commands.drawText(x, y, text, font, atlases.at(font).textureId);
+}
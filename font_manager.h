@@ -4,19 +4,57 @@
 #include <SDL2/SDL_render.h>
 #include <SDL2/SDL_surface.h>
 #include <SDL2/SDL_ttf.h>
+#include <array>
 #include <exception>
 #include <iostream>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "render_commands.h"
+
+const int GLYPH_COUNT = 128;
+
+struct GlyphRect {
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+};
+
+// Every glyph of one font rasterized into a single texture
+struct FontAtlas {
+  SDL_Texture* texture = nullptr;
+  // the texture's TextureRegistry id
+  uint16_t textureId = 0;
+  // alpha of every texel, for rasterizing text on the CPU
+  std::vector<uint8_t> coverage;
+  int width = 0;
+  std::array<GlyphRect, GLYPH_COUNT> glyphs;
+};
+
 class FontManager {
  private:
-  std::vector<std::tuple<TTF_Font*, std::unordered_map<char, SDL_Texture*>>>
-      font_to_cache;
+  std::vector<FontAtlas> atlases;
 
   SDL_Renderer* renderer;
 
+  bool loadCachedAtlas(const std::string& path,
+                       uint64_t key,
+                       FontAtlas& atlas);
+  void keepCoverage(FontAtlas& atlas,
+                    const uint8_t* pixels,
+                    int pitch,
+                    int width,
+                    int height,
+                    uint32_t format);
+  void rasterizeAtlas(const std::string& name,
+                      int size,
+                      uint32_t format,
+                      const std::string& path,
+                      uint64_t key,
+                      FontAtlas& atlas);
+
  public:
   FontManager() = default;
 
@@ -26,11 +64,8 @@ class FontManager {
   }
 
   ~FontManager() {
-    for (auto& font : font_to_cache) {
-      for (auto& texture : std::get<1>(font)) {
-        SDL_DestroyTexture(texture.second);
-      }
-      TTF_CloseFont(std::get<0>(font));
+    for (auto& atlas : atlases) {
+      SDL_DestroyTexture(atlas.texture);
     }
   };
 
@@ -38,5 +73,11 @@ class FontManager {
 
   std::pair<int, int> getTextSize(std::string text, int font);
 
-  void renderText(int x, int y, std::string text, int font);
+  const FontAtlas& getAtlas(int font) const { return atlases.at(font); }
+
+  void renderText(CommandList& commands,
+                  int x,
+                  int y,
+                  std::string text,
+                  int font);
 };
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#include "game_clock.h"
+#include "input_sampler.h"
+
+// Paces frames to a target rate when vsync isn't doing it. Sleeps coarsely
+// until shortly before the frame is due, then spins on the performance
+// counter for the rest. The spin margin follows how badly the OS has been
+// oversleeping lately, so the spin stays as short as it can.
+class FramePacer {
+ private:
+  static constexpr double MIN_SPIN_MARGIN = 200;
+  static constexpr double MAX_SPIN_MARGIN = 4000;
+  // frames needed before deciding whether vsync actually works
+  static const int VSYNC_PROBE_FRAMES = 60;
+
+  uint64_t period = 1000000 / 60;
+  uint64_t next = 0;
+  // microseconds left to spin after the coarse sleep
+  double spinMargin = 2000;
+  double oversleepAverage = 1000;
+
+  uint64_t lastFrame = 0;
+  uint64_t frames = 0;
+  double intervalSum = 0;
+  double intervalSquares = 0;
+  uint64_t intervalMin = UINT64_MAX;
+  uint64_t intervalMax = 0;
+
+ public:
+  void setTargetFps(int fps) {
+    period = 1000000 / std::max(fps, 1);
+    next = nowMicros();
+  }
+
+  uint64_t nextFrame() const { return next; }
+
+  // Waits for input, or until `deadline`. Returns early when input arrives
+  // during the coarse sleep so it can be handled right away.
+  void waitUntil(uint64_t deadline, InputSampler& input, bool fastInput) {
+    uint64_t margin = (uint64_t)spinMargin;
+    uint64_t coarseEnd = deadline > margin ? deadline - margin : 0;
+    uint64_t now = nowMicros();
+    if (now < coarseEnd) {
+      if (fastInput) {
+        input.pumpUntil(coarseEnd);
+      } else {
+        input.waitUntil(coarseEnd);
+      }
+      now = nowMicros();
+      if (now < coarseEnd) {
+        return;
+      }
+      // adapt to how late the sleep came back
+      oversleepAverage = oversleepAverage * 0.9 + (now - coarseEnd) * 0.1;
+      spinMargin = std::clamp(oversleepAverage * 1.5 + MIN_SPIN_MARGIN,
+                              MIN_SPIN_MARGIN, MAX_SPIN_MARGIN);
+    }
+    while (nowMicros() < deadline) {
+    }
+    input.pump();
+  }
+
+  // Call right after presenting a frame
+  void frameDone(uint64_t now) {
+    if (lastFrame != 0) {
+      uint64_t interval = now - lastFrame;
+      frames++;
+      intervalSum += interval;
+      intervalSquares += (double)interval * interval;
+      intervalMin = std::min(intervalMin, interval);
+      intervalMax = std::max(intervalMax, interval);
+    }
+    lastFrame = now;
+    next = std::max(next + period, now);
+  }
+
+  // Whether presents have been coming back much faster than the target
+  // period, which means vsync was asked for but isn't being honored
+  bool presentsTooFast() const {
+    return frames == VSYNC_PROBE_FRAMES &&
+           intervalSum / frames < period / 2.0;
+  }
+
+  void report() const {
+    if (frames == 0) {
+      return;
+    }
+    double mean = intervalSum / frames;
+    double variance = intervalSquares / frames - mean * mean;
+    std::cout << "frames: " << frames << ", target " << period / 1000.0
+              << " ms, avg " << mean / 1000 << " ms, jitter "
+              << std::sqrt(std::max(variance, 0.0)) / 1000 << " ms, min "
+              << intervalMin / 1000.0 << " ms, max " << intervalMax / 1000.0
+              << " ms, spin margin " << spinMargin / 1000 << " ms"
+              << std::endl;
+  }
+};
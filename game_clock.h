@@ -0,0 +1,13 @@
+#pragma once
+
+#include <SDL2/SDL_timer.h>
+#include <cstdint>
+
+// Microseconds on the performance counter. Finer than SDL_GetTicks and the
+// one time base shared by input timestamps and the game simulation.
+inline uint64_t nowMicros() {
+  static const uint64_t frequency = SDL_GetPerformanceFrequency();
+  uint64_t counter = SDL_GetPerformanceCounter();
+  return counter / frequency * 1000000 +
+         counter % frequency * 1000000 / frequency;
+}
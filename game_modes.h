@@ -0,0 +1,15 @@
+#pragma once
+
+#include <iterator>
+
+// Board sizes the game can be played on, picked with --mode. Each one is
+// its own TetrisGame instantiation.
+struct GameMode {
+  const char* name;
+  int width;
+  int height;
+};
+
+constexpr GameMode GAME_MODES[] = {
+    {"standard", 10, 20}, {"narrow", 4, 20}, {"tall", 10, 40}, {"big", 20, 20}};
+constexpr int MODE_COUNT = std::size(GAME_MODES);
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_events.h>
+#include <SDL2/SDL_timer.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#include "game_clock.h"
+#include "spsc_ring.h"
+
+struct InputEvent {
+  SDL_Event event;
+  // nowMicros() when the event was pulled off the OS queue
+  uint64_t timestamp;
+};
+
+// Pulls events off SDL's queue, stamps them and queues them for the
+// simulation in arrival order.
+//
+// SDL only allows pumping events on the thread that owns the window, so
+// instead of a separate thread the main loop calls pumpUntil() while it
+// waits for the next frame, sampling input about every millisecond rather
+// than once per frame.
+class InputSampler {
+ private:
+  static const int PEEK_BATCH = 32;
+
+  SpscRing<InputEvent, 512> events;
+
+  // sampling interval and event age statistics, in microseconds
+  uint64_t lastPump = 0;
+  uint64_t intervals = 0;
+  double intervalSum = 0;
+  double intervalSquares = 0;
+  uint64_t intervalMax = 0;
+  uint64_t drained = 0;
+  double ageSum = 0;
+  uint64_t ageMax = 0;
+  uint64_t overflowed = 0;
+
+ public:
+  // Moves everything SDL has queued into the ring
+  void pump() {
+    uint64_t now = nowMicros();
+    if (lastPump != 0) {
+      uint64_t interval = now - lastPump;
+      intervals++;
+      intervalSum += interval;
+      intervalSquares += (double)interval * interval;
+      intervalMax = std::max(intervalMax, interval);
+    }
+    lastPump = now;
+
+    SDL_PumpEvents();
+    SDL_Event batch[PEEK_BATCH];
+    int count;
+    while ((count = SDL_PeepEvents(batch, PEEK_BATCH, SDL_GETEVENT,
+                                   SDL_FIRSTEVENT, SDL_LASTEVENT)) > 0) {
+      for (int i = 0; i < count; i++) {
+        if (!events.push({batch[i], now})) {
+          overflowed++;
+        }
+      }
+    }
+  }
+
+  // Keeps pumping about once a millisecond until `deadline`
+  void pumpUntil(uint64_t deadline) {
+    pump();
+    uint64_t now = nowMicros();
+    while (now < deadline) {
+      uint64_t remaining = deadline - now;
+      if (remaining >= 1000) {
+        SDL_Delay(1);
+      }
+      pump();
+      now = nowMicros();
+    }
+  }
+
+  // Sleeps until SDL has an event or `deadline` passes, then pumps
+  void waitUntil(uint64_t deadline) {
+    uint64_t now = nowMicros();
+    if (now < deadline) {
+      uint64_t timeoutMs = (deadline - now + 999) / 1000;
+      SDL_WaitEventTimeout(NULL, (int)std::min<uint64_t>(timeoutMs, 1000));
+    }
+    pump();
+  }
+
+  // Hands queued events to `handle` oldest first
+  template <typename Handler>
+  void drain(Handler&& handle) {
+    InputEvent input;
+    while (events.pop(input)) {
+      uint64_t age = nowMicros() - input.timestamp;
+      drained++;
+      ageSum += age;
+      ageMax = std::max(ageMax, age);
+      handle(input);
+    }
+  }
+
+  void report() const {
+    if (intervals == 0) {
+      return;
+    }
+    double mean = intervalSum / intervals;
+    double variance = intervalSquares / intervals - mean * mean;
+    std::cout << "input sampling: every " << mean / 1000 << " ms, jitter "
+              << std::sqrt(std::max(variance, 0.0)) / 1000 << " ms, worst "
+              << intervalMax / 1000.0 << " ms" << std::endl;
+    if (drained > 0) {
+      std::cout << "input age when handled: avg " << ageSum / drained / 1000
+                << " ms, worst " << ageMax / 1000.0 << " ms over " << drained
+                << " events" << std::endl;
+    }
+    if (overflowed > 0) {
+      std::cout << overflowed << " input events lost to a full queue"
+                << std::endl;
+    }
+  }
+};
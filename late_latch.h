@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+// Predicts the next vblank from when vsynced presents return and picks the
+// latest moment input can be read and still make it. Reading input and
+// updating there, instead of right after the previous present, shows each
+// frame with input that much fresher.
+class LateLatch {
+ private:
+  // extra slack on top of the expected work, in microseconds
+  static const uint64_t SAFETY_MARGIN = 1000;
+
+  double period = 1000000 / 60.0;
+  // how long input + update + render take, in microseconds
+  double workAverage = 2000;
+  uint64_t lastPresent = 0;
+  uint64_t latchedAt = 0;
+
+  uint64_t frames = 0;
+  double gainedSum = 0;
+  uint64_t missed = 0;
+
+ public:
+  void setRefreshRate(int hz) { period = 1000000.0 / std::max(hz, 1); }
+
+  // When to read input for the next frame
+  uint64_t latchTime() const {
+    if (lastPresent == 0) {
+      return 0;
+    }
+    uint64_t predictedVblank = lastPresent + (uint64_t)period;
+    uint64_t budget = (uint64_t)(workAverage * 1.5) + SAFETY_MARGIN;
+    return predictedVblank > budget ? predictedVblank - budget : 0;
+  }
+
+  void latched(uint64_t now) {
+    latchedAt = now;
+    if (lastPresent != 0 && now > lastPresent) {
+      frames++;
+      gainedSum += now - lastPresent;
+    }
+  }
+
+  // Call right before presenting
+  void workDone(uint64_t now) {
+    workAverage = workAverage * 0.9 + (now - latchedAt) * 0.1;
+  }
+
+  // Call when frames stop for a while, so the gap isn't taken for a miss
+  void pause() { lastPresent = 0; }
+
+  // Call right after a vsynced present returns
+  void presented(uint64_t now) {
+    if (lastPresent != 0) {
+      double interval = now - lastPresent;
+      if (interval > period * 1.5) {
+        missed++;
+      } else {
+        period = period * 0.95 + interval * 0.05;
+      }
+    }
+    lastPresent = now;
+  }
+
+  void report() const {
+    if (frames == 0) {
+      return;
+    }
+    std::cout << "late latch: input read " << gainedSum / frames / 1000
+              << " ms later than right after present, work "
+              << workAverage / 1000 << " ms, vblank every " << period / 1000
+              << " ms, " << missed << " missed" << std::endl;
+  }
+};
@@ -2,8 +2,18 @@
 #include <SDL2/SDL_hints.h>
 #include <SDL2/SDL_mixer.h>
 #include <SDL2/SDL_ttf.h>
+#include "audio_monitor.h"
 #include "font_manager.h"
+#include "frame_pacer.h"
+#include "game_clock.h"
+#include "input_sampler.h"
+#include "late_latch.h"
 #include "menu.h"
+#include "render_backend.h"
+#include "render_commands.h"
+#include "settings.h"
+#include "software_backend.h"
+#include "sound_manager.h"
 
 #include <SDL2/SDL_events.h>
 #include <SDL2/SDL_keycode.h>
@@ -12,7 +22,9 @@
 #include <SDL2/SDL_timer.h>
 #include <SDL2/SDL_video.h>
 #include <sys/types.h>
+#include <algorithm>
 #include <ctime>
+#include <fstream>
 #include <iostream>
 #include <memory>
 
@@ -22,10 +34,38 @@ const int DEFAULT_SCREEN_HEIGHT = 768;
 SDL_Window* window;
 SDL_Renderer* renderer;
 TTF_Font* openSans;
+InputSampler inputSampler;
+FramePacer framePacer;
+LateLatch lateLatch;
+CommandList commandList;
+RenderBackend renderBackend;
+SoftwareBackend softwareBackend;
+CommandBackend* backend = &renderBackend;
+std::ofstream commandDump;
 
 void close() {
+  softwareBackend.release();
   SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
+  Settings& settings = Settings::getInstance();
+  if (settings.lowLatencyAudio || settings.audioStats) {
+    AudioMonitor::getInstance().report();
+  }
+  if (settings.audioStats) {
+    SoundManager::getInstance().reportVoices();
+  }
+  if (settings.inputStats) {
+    inputSampler.report();
+  }
+  if (settings.frameStats) {
+    framePacer.report();
+    backend->report();
+    if (settings.lateLatch) {
+      lateLatch.report();
+    }
+  }
+  AudioMonitor::getInstance().detach();
+  Mix_CloseAudio();
   Mix_Quit();
   SDL_Quit();
 }
@@ -35,7 +75,8 @@ int main(int argc, char* argv[]) {
   #ifdef __linux__
     setenv("SDL_VIDEODRIVER", "x11", 1);
   #endif
-  
+  Settings::getInstance().parse(argc, argv);
+
   if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
     std::cout << "could not init!" << std::endl;
     return 1;
@@ -48,8 +89,15 @@ int main(int argc, char* argv[]) {
     std::cout << "could not create window!" << std::endl;
     return 1;
   }
-  renderer = SDL_CreateRenderer(
-      window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+  // Fast input and a fixed frame rate pace frames themselves so they can
+  // keep sampling input while they wait, instead of blocking in a vsynced
+  // present
+  Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+  if (!Settings::getInstance().fastInput &&
+      Settings::getInstance().targetFps == 0) {
+    rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+  }
+  renderer = SDL_CreateRenderer(window, -1, rendererFlags);
 
   if (renderer == NULL) {
     std::cout << "could not create renderer!" << std::endl;
@@ -63,34 +111,131 @@ int main(int argc, char* argv[]) {
 
   Mix_Init(MIX_INIT_OGG);
 
-  if (Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT,
-                    MIX_DEFAULT_CHANNELS, 2048) < 0) {
-    std::cout << "SDL_mixer could not initialize! SDL_mixer Error: "
-              << Mix_GetError() << std::endl;
-    return 1;
+  Settings& settings = Settings::getInstance();
+  int bufferSamples = 0;
+  if (settings.lowLatencyAudio) {
+    bufferSamples = openLowLatencyAudio();
+    if (bufferSamples) {
+      std::cout << "low latency audio with " << bufferSamples
+                << " sample buffer" << std::endl;
+    } else {
+      std::cout << "no stable low latency buffer, falling back to "
+                << settings.audioBufferSamples << std::endl;
+    }
+  }
+  if (!bufferSamples) {
+    bufferSamples = settings.audioBufferSamples;
+    if (Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT,
+                      MIX_DEFAULT_CHANNELS, bufferSamples) < 0) {
+      std::cout << "SDL_mixer could not initialize! SDL_mixer Error: "
+                << Mix_GetError() << std::endl;
+      return 1;
+    }
+    int frequency;
+    Mix_QuerySpec(&frequency, NULL, NULL);
+    AudioMonitor::getInstance().attach(frequency, bufferSamples);
   }
+  SoundManager::getInstance().startLoading(bufferSamples);
 
   std::random_device rd;
   std::mt19937 gen(rd());
   FontManager::getInstance().initialize(renderer);
   SceneManager sceneManager = SceneManager();
   sceneManager.change(std::make_shared<Menu>(sceneManager));
-  SDL_Event event;
 
-  const Uint8* keyState = SDL_GetKeyboardState(NULL);
+  int targetFps = settings.targetFps;
+  SDL_DisplayMode displayMode;
+  if (targetFps == 0) {
+    targetFps = 60;
+    if (SDL_GetCurrentDisplayMode(0, &displayMode) == 0 &&
+        displayMode.refresh_rate > 0) {
+      targetFps = displayMode.refresh_rate;
+    }
+  }
+  framePacer.setTargetFps(targetFps);
+  lateLatch.setRefreshRate(targetFps);
+
+  // Without vsync nothing else would stop the loop from spinning, so sleep
+  // until the next frame, input, or game deadline, whichever comes first
+  SDL_RendererInfo rendererInfo;
+  SDL_GetRendererInfo(renderer, &rendererInfo);
+  bool vsync = rendererInfo.flags & SDL_RENDERER_PRESENTVSYNC;
+
+  // SDL's own software renderer is slow with many small rects
+  if (settings.raster == "cpu" ||
+      (settings.raster == "auto" &&
+       (rendererInfo.flags & SDL_RENDERER_SOFTWARE))) {
+    backend = &softwareBackend;
+  }
+
+  if (!settings.dumpCommands.empty()) {
+    commandDump.open(settings.dumpCommands, std::ios::binary);
+    if (!commandDump) {
+      std::cout << "could not open " << settings.dumpCommands << std::endl;
+    }
+  }
 
   while (true) {
-    while (SDL_PollEvent(&event)) {
-      if (event.type == SDL_QUIT) {
-        close();
-        return 0;
-      }
+    if (!sceneManager.curScene->needsRedraw()) {
+      // nothing to draw, block until something happens
+      inputSampler.waitUntil(sceneManager.curScene->nextDeadline());
+    } else if (vsync && settings.lateLatch) {
+      // keep sampling until just before the predicted vblank
+      inputSampler.pumpUntil(lateLatch.latchTime());
+    } else if (vsync) {
+      inputSampler.pump();
+    } else {
+      uint64_t wakeAt = std::min(framePacer.nextFrame(),
+                                 sceneManager.curScene->nextDeadline());
+      framePacer.waitUntil(wakeAt, inputSampler, settings.fastInput);
+    }
 
-      sceneManager.curScene->handleInput(event);
+    lateLatch.latched(nowMicros());
+    bool quit = false;
+    inputSampler.drain([&](const InputEvent& input) {
+      if (input.event.type == SDL_QUIT) {
+        quit = true;
+      } else if (!quit) {
+        if (input.event.type == SDL_WINDOWEVENT) {
+          sceneManager.curScene->invalidate();
+        }
+        sceneManager.curScene->handleInput(input.event, input.timestamp);
+      }
+    });
+    if (quit) {
+      // stop the game's simulation thread before audio goes away under it
+      sceneManager.change(nullptr);
+      close();
+      return 0;
+    }
+    uint64_t now = nowMicros();
+    sceneManager.curScene->update(now);
+    if (!sceneManager.curScene->needsRedraw()) {
+      lateLatch.pause();
+      continue;
+    }
+    if (!vsync && now < framePacer.nextFrame()) {
+      // woke up early for input or a deadline, the frame isn't due yet
+      continue;
     }
-    sceneManager.curScene->update();
-    sceneManager.curScene->render(renderer);
+    sceneManager.curScene->render(commandList);
+    backend->submit(renderer, commandList);
+    if (commandDump.is_open()) {
+      commandList.save(commandDump);
+    }
+    lateLatch.workDone(nowMicros());
     SDL_RenderPresent(renderer);
+    sceneManager.curScene->dirty = false;
+    now = nowMicros();
+    framePacer.frameDone(now);
+    lateLatch.presented(now);
+
+    // software and dummy renderers can claim vsync and then ignore it
+    if (vsync && framePacer.presentsTooFast()) {
+      std::cout << "vsync isn't being honored, limiting to " << targetFps
+                << " fps" << std::endl;
+      vsync = false;
+    }
   }
   close();
   return 0;
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. Empty if the file couldn't be
+// opened or mapped, so callers just check valid() and fall back.
+class MappedFile {
+ private:
+  const uint8_t* bytes = nullptr;
+  size_t length = 0;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = NULL;
+#endif
+
+  void close() {
+#ifdef _WIN32
+    if (bytes) {
+      UnmapViewOfFile(bytes);
+    }
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+      CloseHandle(file);
+    }
+    file = INVALID_HANDLE_VALUE;
+    mapping = NULL;
+#else
+    if (bytes) {
+      munmap(const_cast<uint8_t*>(bytes), length);
+    }
+#endif
+    bytes = nullptr;
+    length = 0;
+  }
+
+ public:
+  MappedFile() = default;
+
+  explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+      return;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+      close();
+      return;
+    }
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+      close();
+      return;
+    }
+    bytes = static_cast<const uint8_t*>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!bytes) {
+      close();
+      return;
+    }
+    length = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      ::close(fd);
+      return;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+      return;
+    }
+    bytes = static_cast<const uint8_t*>(addr);
+    length = static_cast<size_t>(st.st_size);
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+      close();
+      std::swap(bytes, other.bytes);
+      std::swap(length, other.length);
+#ifdef _WIN32
+      std::swap(file, other.file);
+      std::swap(mapping, other.mapping);
+#endif
+    }
+    return *this;
+  }
+
+  ~MappedFile() { close(); }
+
+  bool valid() const { return bytes != nullptr; }
+  const uint8_t* data() const { return bytes; }
+  size_t size() const { return length; }
+};
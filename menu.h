@@ -11,6 +11,7 @@
 
 #include <cstdint>
 #include <ctime>
+#include <format>
 #include <iostream>
 #include <memory>
 #include <optional>
@@ -18,22 +19,53 @@
 #include <vector>
 
 #include "Scene.h"
+#include "game_clock.h"
+#include "sound_manager.h"
 #include "tetris.h"
 
+const uint64_t LOADING_POLL_INTERVAL = 50000;
+
 class Menu : public Scene {
+ private:
+  int drawnProgress = -1;
+
  public:
   Menu(SceneManager& sceneManager) : Scene(sceneManager) {}
 
-  void render(SDL_Renderer* renderer) override {
-    FontManager::getInstance().renderText(80, 60, "40L TETRIS", 1);
-    FontManager::getInstance().renderText(80, 110, "Press any key to start", 0);
+  void render(CommandList& commands) override {
+    commands.clear({0, 0, 0, 255});
+    FontManager::getInstance().renderText(commands, 80, 60, "40L TETRIS", 1);
+    drawnProgress = SoundManager::getInstance().loadedCount();
+    if (SoundManager::getInstance().isLoaded()) {
+      FontManager::getInstance().renderText(commands, 80, 110,
+                                            "Press any key to start", 0);
+    } else {
+      std::string progress =
+          std::format("Loading sounds {}/{}",
+                      SoundManager::getInstance().loadedCount(),
+                      SoundManager::ASSET_COUNT);
+      FontManager::getInstance().renderText(commands, 80, 110, progress, 0);
+    }
   }
 
-  void handleInput(const SDL_Event& event) override {
-    if (event.type == SDL_KEYDOWN) {
+  void handleInput(const SDL_Event& event, uint64_t time) override {
+    // a game can't start until its sounds are resident
+    if (event.type == SDL_KEYDOWN && SoundManager::getInstance().isLoaded()) {
       sceneManager.change(std::make_shared<Tetris>(sceneManager));
     }
   }
 
-  void update() override {};
+  void update(uint64_t now) override {};
+
+  // Check back on the loader now and then until the sounds are in
+  uint64_t nextDeadline() override {
+    if (SoundManager::getInstance().isLoaded()) {
+      return NO_DEADLINE;
+    }
+    return nowMicros() + LOADING_POLL_INTERVAL;
+  }
+
+  bool needsRedraw() override {
+    return dirty || drawnProgress != SoundManager::getInstance().loadedCount();
+  }
 };
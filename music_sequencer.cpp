@@ -0,0 +1,118 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "music_sequencer.h"
+#include "settings.h"
+
+void MusicSequencer::open(const Mix_Chunk* p_intro,
+                          const Mix_Chunk* p_loop,
+                          int p_volume,
+                          int bufferFrames) {
+  static_assert(2 * MAX_AUDIO_BUFFER_SAMPLES * 4 <= RING_BYTES,
+                "the ring has to hold two of the largest device buffers");
+  close();
+  intro = p_intro;
+  loop = p_loop;
+  volume = p_volume;
+
+  int channels;
+  Mix_QuerySpec(&frequency, &format, &channels);
+  frameBytes = SDL_AUDIO_BITSIZE(format) / 8 * channels;
+  int lookaheadFrames = std::max(MIN_LOOKAHEAD_FRAMES, 2 * bufferFrames);
+  lookaheadBytes = lookaheadFrames * frameBytes;
+  if (lookaheadBytes > RING_BYTES) {
+    std::cout << "music look-ahead capped at " << RING_BYTES / frameBytes
+              << " frames, expect gaps" << std::endl;
+    lookaheadBytes = RING_BYTES;
+  }
+  source.resize(BLOCK_FRAMES * frameBytes);
+  block.resize(BLOCK_FRAMES * frameBytes);
+
+  running = true;
+  worker = std::thread(&MusicSequencer::run, this);
+  Mix_HookMusic(mixMusic, this);
+}
+
+void MusicSequencer::close() {
+  if (!running) {
+    return;
+  }
+  Mix_HookMusic(NULL, NULL);
+  running = false;
+  worker.join();
+}
+
+void MusicSequencer::run() {
+  while (running) {
+    MusicCommand command;
+    while (commands.pop(command)) {
+      apply(command);
+    }
+
+    if (playing && samples.size() + block.size() <= lookaheadBytes) {
+      renderBlock();
+      samples.write(block.data(), block.size());
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+void MusicSequencer::apply(const MusicCommand& command) {
+  // how much the gain moves per block to finish the fade in fadeMs
+  float blocks = (float)command.fadeMs * frequency / 1000 / BLOCK_FRAMES;
+  float step = blocks >= 1 ? 1 / blocks : 1;
+  switch (command.type) {
+    case MusicCommandType::Play:
+      playing = true;
+      inIntro = true;
+      position = 0;
+      gain = command.fadeMs > 0 ? 0 : 1;
+      gainStep = step;
+      break;
+    case MusicCommandType::FadeOut:
+      gainStep = -step;
+      break;
+  }
+}
+
+// Fills one block from the intro or the loop, switching from the intro to
+// the loop at the exact frame the intro runs out.
+void MusicSequencer::renderBlock() {
+  size_t filled = 0;
+  while (filled < source.size()) {
+    const Mix_Chunk* track = inIntro ? intro : loop;
+    size_t count = std::min(source.size() - filled, track->alen - position);
+    std::memcpy(source.data() + filled, track->abuf + position, count);
+    filled += count;
+    position += count;
+    if (position >= track->alen) {
+      inIntro = false;
+      position = 0;
+    }
+  }
+
+  std::memset(block.data(), 0, block.size());
+  int blockVolume = (int)(gain * volume + 0.5f);
+  SDL_MixAudioFormat(block.data(), source.data(), format, block.size(),
+                     blockVolume);
+
+  gain = std::clamp(gain + gainStep, 0.0f, 1.0f);
+  if (gain == 0 && gainStep < 0) {
+    playing = false;
+  }
+}
+
+// Runs on the audio thread; never blocks, a late worker just means silence
+void MusicSequencer::mixMusic(void* udata, Uint8* stream, int len) {
+  MusicSequencer* sequencer = static_cast<MusicSequencer*>(udata);
+  size_t read = sequencer->samples.read(stream, len);
+  if (read < (size_t)len) {
+    std::memset(stream + read, 0, len - read);
+  }
+}
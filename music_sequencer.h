@@ -0,0 +1,81 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "spsc_ring.h"
+
+enum class MusicCommandType { Play, FadeOut };
+
+struct MusicCommand {
+  MusicCommandType type;
+  uint32_t fadeMs;
+};
+
+// Plays an intro followed by an endlessly repeating loop with no gap at the
+// splice. A worker thread renders a short way ahead into a ring buffer that
+// SDL_mixer's music hook drains on the audio thread, and the game thread
+// steers it with commands instead of calling into the mixer.
+class MusicSequencer {
+ private:
+  // room for two device buffers of MAX_AUDIO_BUFFER_SAMPLES 16-bit stereo
+  // frames
+  static constexpr size_t RING_BYTES = 1 << 17;
+  static constexpr int MIN_LOOKAHEAD_FRAMES = 2048;
+  static constexpr int BLOCK_FRAMES = 256;
+
+  const Mix_Chunk* intro = nullptr;
+  const Mix_Chunk* loop = nullptr;
+  int volume = MIX_MAX_VOLUME;
+  Uint16 format = AUDIO_S16SYS;
+  int frequency = MIX_DEFAULT_FREQUENCY;
+  size_t frameBytes = 4;
+  size_t lookaheadBytes = 0;
+
+  SpscRing<Uint8, RING_BYTES> samples;
+  SpscRing<MusicCommand, 16> commands;
+  std::thread worker;
+  std::atomic<bool> running = false;
+
+  // Only touched by the worker
+  bool playing = false;
+  bool inIntro = true;
+  size_t position = 0;
+  float gain = 0;
+  float gainStep = 0;
+  std::vector<Uint8> source;
+  std::vector<Uint8> block;
+
+  void run();
+  void apply(const MusicCommand& command);
+  void renderBlock();
+  static void mixMusic(void* udata, Uint8* stream, int len);
+
+ public:
+  MusicSequencer() = default;
+  MusicSequencer(const MusicSequencer&) = delete;
+  MusicSequencer& operator=(const MusicSequencer&) = delete;
+  ~MusicSequencer() { close(); }
+
+  // Both chunks must already be in the device format and outlive close().
+  // The worker keeps two device buffers of `bufferFrames` rendered ahead,
+  // so every callback finds a full buffer waiting.
+  void open(const Mix_Chunk* p_intro,
+            const Mix_Chunk* p_loop,
+            int p_volume,
+            int bufferFrames);
+  void close();
+
+  // Restart from the top of the intro, fading in over fadeInMs
+  void play(uint32_t fadeInMs) {
+    commands.push({MusicCommandType::Play, fadeInMs});
+  }
+
+  void fadeOut(uint32_t fadeMs) {
+    commands.push({MusicCommandType::FadeOut, fadeMs});
+  }
+};
@@ -0,0 +1,157 @@
+#include "render_backend.h"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_render.h>
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+
+#include "font_manager.h"
+#include "texture_registry.h"
+
+// Commands that can go out in the same SDL_RenderGeometry call
+static bool sameBatch(const RenderCommand& a, const RenderCommand& b) {
+  return a.layer == b.layer && a.blend == b.blend && a.texture == b.texture;
+}
+
+void RenderBackend::addQuad(float x,
+                            float y,
+                            float w,
+                            float h,
+                            SDL_Color color,
+                            float u0,
+                            float v0,
+                            float u1,
+                            float v1) {
+  int base = vertices.size();
+  vertices.push_back({{x, y}, color, {u0, v0}});
+  vertices.push_back({{x + w, y}, color, {u1, v0}});
+  vertices.push_back({{x + w, y + h}, color, {u1, v1}});
+  vertices.push_back({{x, y + h}, color, {u0, v1}});
+  for (int i : {0, 1, 2, 0, 2, 3}) {
+    indices.push_back(base + i);
+  }
+}
+
+void RenderBackend::addCommand(const CommandList& list,
+                               const RenderCommand& command) {
+  const TextureInfo& texture =
+      TextureRegistry::getInstance().get(command.texture);
+  float scaleU = texture.width ? 1.0f / texture.width : 0;
+  float scaleV = texture.height ? 1.0f / texture.height : 0;
+
+  switch (command.type) {
+    case CommandType::Fill:
+      addQuad(command.x, command.y, command.w, command.h, command.color);
+      break;
+    case CommandType::Outline:
+      // one pixel wide edges, covering the same pixels as SDL_RenderDrawRect
+      addQuad(command.x, command.y, command.w, 1, command.color);
+      addQuad(command.x, command.y + command.h - 1, command.w, 1,
+              command.color);
+      addQuad(command.x, command.y + 1, 1, command.h - 2, command.color);
+      addQuad(command.x + command.w - 1, command.y + 1, 1, command.h - 2,
+              command.color);
+      break;
+    case CommandType::Blit:
+      addQuad(command.x, command.y, command.w, command.h, command.color,
+              command.srcX * scaleU, command.srcY * scaleV,
+              (command.srcX + command.srcW) * scaleU,
+              (command.srcY + command.srcH) * scaleV);
+      break;
+    case CommandType::Text: {
+      const FontAtlas& atlas =
+          FontManager::getInstance().getAtlas(command.font);
+      int x = command.x;
+      int y = command.y;
+      for (char c : list.textOf(command)) {
+        const GlyphRect& glyph = atlas.glyphs[(uint8_t)c % GLYPH_COUNT];
+        if (c == '\n') {
+          y += glyph.h;
+          x = command.x;
+          continue;
+        }
+        addQuad(x, y, glyph.w, glyph.h, command.color, glyph.x * scaleU,
+                glyph.y * scaleV, (glyph.x + glyph.w) * scaleU,
+                (glyph.y + glyph.h) * scaleV);
+        x += glyph.w;
+      }
+      break;
+    }
+  }
+}
+
+void RenderBackend::flush(SDL_Renderer* renderer,
+                          const RenderCommand& command) {
+  if (indices.empty()) {
+    return;
+  }
+  SDL_BlendMode blend = command.blend == BlendMode::Alpha
+                            ? SDL_BLENDMODE_BLEND
+                            : SDL_BLENDMODE_NONE;
+  SDL_Texture* texture =
+      TextureRegistry::getInstance().get(command.texture).texture;
+  // untextured geometry uses the draw blend mode, textured the texture's
+  if (texture) {
+    SDL_SetTextureBlendMode(texture, blend);
+  } else {
+    SDL_SetRenderDrawBlendMode(renderer, blend);
+  }
+  SDL_RenderGeometry(renderer, texture, vertices.data(), vertices.size(),
+                     indices.data(), indices.size());
+  drawCalls++;
+  vertices.clear();
+  indices.clear();
+}
+
+void RenderBackend::submit(SDL_Renderer* renderer, const CommandList& list) {
+  drawCalls = 0;
+  textureSwitches = 0;
+
+  SDL_SetRenderDrawColor(renderer, list.clearColor.r, list.clearColor.g,
+                         list.clearColor.b, list.clearColor.a);
+  SDL_RenderClear(renderer);
+
+  const std::vector<RenderCommand>& commands = list.commands;
+  order.resize(commands.size());
+  for (uint32_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  // stable, so commands keep their recorded order inside a batch
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    const RenderCommand& ca = commands[a];
+    const RenderCommand& cb = commands[b];
+    return std::tie(ca.layer, ca.blend, ca.texture) <
+           std::tie(cb.layer, cb.blend, cb.texture);
+  });
+
+  const RenderCommand* batch = nullptr;
+  for (uint32_t index : order) {
+    const RenderCommand& command = commands[index];
+    if (batch && !sameBatch(*batch, command)) {
+      flush(renderer, *batch);
+      if (batch->texture != command.texture) {
+        textureSwitches++;
+      }
+    }
+    batch = &command;
+    addCommand(list, command);
+  }
+  if (batch) {
+    flush(renderer, *batch);
+  }
+
+  frames++;
+  commandTotal += commands.size();
+  drawCallTotal += drawCalls;
+  textureSwitchTotal += textureSwitches;
+}
+
+void RenderBackend::report() const {
+  if (frames == 0) {
+    return;
+  }
+  std::cout << "render commands: " << (double)commandTotal / frames
+            << " per frame in " << (double)drawCallTotal / frames
+            << " draw calls, " << (double)textureSwitchTotal / frames
+            << " texture switches" << std::endl;
+}
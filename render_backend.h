@@ -0,0 +1,59 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_render.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "render_commands.h"
+
+// Something that turns a recorded frame into pixels on a renderer
+class CommandBackend {
+ public:
+  // calls made for the last frame submitted
+  int drawCalls = 0;
+  int textureSwitches = 0;
+
+  virtual ~CommandBackend() = default;
+
+  virtual const char* name() const = 0;
+
+  virtual void submit(SDL_Renderer* renderer, const CommandList& list) = 0;
+
+  virtual void report() const = 0;
+};
+
+// Draws a CommandList through SDL_Renderer. Commands are sorted by layer,
+// blend mode and texture, and each run that shares all three goes out as
+// a single SDL_RenderGeometry call.
+class RenderBackend : public CommandBackend {
+ private:
+  std::vector<uint32_t> order;
+  std::vector<SDL_Vertex> vertices;
+  std::vector<int> indices;
+
+  uint64_t frames = 0;
+  uint64_t commandTotal = 0;
+  uint64_t drawCallTotal = 0;
+  uint64_t textureSwitchTotal = 0;
+
+  void addQuad(float x,
+               float y,
+               float w,
+               float h,
+               SDL_Color color,
+               float u0 = 0,
+               float v0 = 0,
+               float u1 = 0,
+               float v1 = 0);
+  void addCommand(const CommandList& list, const RenderCommand& command);
+  void flush(SDL_Renderer* renderer, const RenderCommand& command);
+
+ public:
+  const char* name() const override { return "geometry"; }
+
+  void submit(SDL_Renderer* renderer, const CommandList& list) override;
+
+  void report() const override;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_rect.h>
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+enum class CommandType : uint8_t { Fill, Outline, Blit, Text };
+
+enum class BlendMode : uint8_t { Opaque, Alpha };
+
+// One thing to draw. Plain data so a whole frame can be sorted, copied and
+// written to disk as is.
+struct RenderCommand {
+  CommandType type;
+  BlendMode blend;
+  // drawn in increasing layer order; within a layer the backend reorders
+  // freely, so commands in one layer must not depend on each other's order
+  uint8_t layer;
+  // font index, for text
+  uint8_t font;
+  // TextureRegistry id, 0 for untextured commands
+  uint16_t texture;
+  uint16_t textLength;
+  SDL_Color color;
+  // destination, or the top left corner of a text run
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+  // source rect in the texture, for blits
+  int16_t srcX;
+  int16_t srcY;
+  int16_t srcW;
+  int16_t srcH;
+  // where the run's characters start in CommandList::text
+  uint32_t textOffset;
+};
+
+static_assert(std::is_trivially_copyable_v<RenderCommand>,
+              "commands are written to disk byte for byte");
+
+// Everything a scene draws in one frame, recorded instead of drawn so a
+// backend can batch it
+class CommandList {
+ private:
+  // header of one frame in a dump file
+  struct FrameHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t commandCount;
+    uint32_t textSize;
+    SDL_Color clearColor;
+  };
+
+  static const uint32_t DUMP_MAGIC = 0x4c444d43;
+  static const uint32_t DUMP_VERSION = 1;
+
+  uint8_t layer = 0;
+
+  RenderCommand& add(CommandType type, SDL_Color color) {
+    RenderCommand& command = commands.emplace_back();
+    command = {};
+    command.type = type;
+    command.blend = color.a == 255 ? BlendMode::Opaque : BlendMode::Alpha;
+    command.layer = layer;
+    command.color = color;
+    return command;
+  }
+
+ public:
+  SDL_Color clearColor = {0, 0, 0, 255};
+  std::vector<RenderCommand> commands;
+  std::vector<char> text;
+
+  void clear(SDL_Color color) {
+    clearColor = color;
+    commands.clear();
+    text.clear();
+    layer = 0;
+  }
+
+  void setLayer(uint8_t newLayer) { layer = newLayer; }
+
+  void fillRect(const SDL_Rect& rect, SDL_Color color) {
+    RenderCommand& command = add(CommandType::Fill, color);
+    command.x = rect.x;
+    command.y = rect.y;
+    command.w = rect.w;
+    command.h = rect.h;
+  }
+
+  void outlineRect(const SDL_Rect& rect, SDL_Color color) {
+    RenderCommand& command = add(CommandType::Outline, color);
+    command.x = rect.x;
+    command.y = rect.y;
+    command.w = rect.w;
+    command.h = rect.h;
+  }
+
+  void blit(uint16_t texture,
+            const SDL_Rect& src,
+            const SDL_Rect& dst,
+            SDL_Color color = {255, 255, 255, 255}) {
+    RenderCommand& command = add(CommandType::Blit, color);
+    command.texture = texture;
+    command.x = dst.x;
+    command.y = dst.y;
+    command.w = dst.w;
+    command.h = dst.h;
+    command.srcX = src.x;
+    command.srcY = src.y;
+    command.srcW = src.w;
+    command.srcH = src.h;
+  }
+
+  // `texture` is the font's atlas; the backend lays the glyphs out
+  void drawText(int x,
+                int y,
+                std::string_view string,
+                int font,
+                uint16_t texture,
+                SDL_Color color = {255, 255, 255, 255}) {
+    RenderCommand& command = add(CommandType::Text, color);
+    command.blend = BlendMode::Alpha;
+    command.font = font;
+    command.texture = texture;
+    command.x = x;
+    command.y = y;
+    command.textOffset = text.size();
+    command.textLength = string.size();
+    text.insert(text.end(), string.begin(), string.end());
+  }
+
+  std::string_view textOf(const RenderCommand& command) const {
+    return {text.data() + command.textOffset, command.textLength};
+  }
+
+  // Appends this frame to a dump
+  void save(std::ostream& out) const {
+    FrameHeader header = {DUMP_MAGIC, DUMP_VERSION, (uint32_t)commands.size(),
+                          (uint32_t)text.size(), clearColor};
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)commands.data(),
+              commands.size() * sizeof(RenderCommand));
+    out.write(text.data(), text.size());
+  }
+
+  // Reads the next frame of a dump, false at the end or on a bad file
+  bool load(std::istream& in) {
+    FrameHeader header;
+    if (!in.read((char*)&header, sizeof(header)) ||
+        header.magic != DUMP_MAGIC || header.version != DUMP_VERSION) {
+      return false;
+    }
+    clear(header.clearColor);
+    commands.resize(header.commandCount);
+    text.resize(header.textSize);
+    in.read((char*)commands.data(), commands.size() * sizeof(RenderCommand));
+    in.read(text.data(), text.size());
+    return (bool)in;
+  }
+};
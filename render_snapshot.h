@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+// the largest board of any mode
+const int MAX_GRID_WIDTH = 20;
+const int MAX_GRID_HEIGHT = 40;
+const int MAX_PIECE_SIZE = 4;
+
+// Everything needed to draw one frame of a game, copied out of the
+// simulation so the renderer never touches live game state. Plain data
+// only, so handing one over is just a copy.
+struct RenderSnapshot {
+  // size of the board, the rest of grid is unused
+  int8_t width;
+  int8_t height;
+  // block type of every cell, -1 when empty
+  int8_t grid[MAX_GRID_HEIGHT][MAX_GRID_WIDTH];
+  // the falling piece in its current rotation
+  int8_t piece[MAX_PIECE_SIZE][MAX_PIECE_SIZE];
+  int8_t pieceSize;
+  int8_t pieceType;
+  int8_t pieceRow;
+  int8_t pieceCol;
+  int8_t ghostRow;
+  // -1 when nothing is held
+  int8_t heldType;
+  int8_t nextType;
+  bool gameOver;
+  int32_t linesLeft;
+  uint32_t elapsedMs;
+  char gameOverText[40];
+};
+
+static_assert(std::is_trivially_copyable_v<RenderSnapshot>,
+              "snapshots are handed between threads by copying");
@@ -1,17 +1,38 @@
 #pragma once
+#include <cstdint>
 #include <random>
 
+// PCG32 (pcg-random.org): 16 bytes of state, so it can live inside game
+// state that gets copied as bytes, and the same seed gives the same pieces.
 class RNG {
  private:
-  RNG() {
-    std::random_device rd;
-    gen = std::mt19937(rd());
-  }
+  uint64_t state = 0;
+  uint64_t increment = 1;
 
  public:
-  std::mt19937 gen;
-  static RNG& getInstance() {
-    static RNG rng = RNG();
-    return rng;
+  void seed(uint64_t seed, uint64_t stream = 0) {
+    state = 0;
+    increment = stream << 1 | 1;
+    next();
+    state += seed;
+    next();
+  }
+
+  uint32_t next() {
+    uint64_t old = state;
+    state = old * 6364136223846793005ull + increment;
+    uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+    uint32_t rotation = old >> 59;
+    return xorshifted >> rotation | xorshifted << (-rotation & 31);
+  }
+
+  // Uniform in [0, n) by multiplying and shifting, with a bias too small
+  // to matter for a handful of values
+  int below(int n) { return (uint64_t)next() * n >> 32; }
+
+  // A different seed every run
+  static uint64_t randomSeed() {
+    std::random_device device;
+    return (uint64_t)device() << 32 | device();
   }
 };
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+const uint64_t NO_DEADLINE = std::numeric_limits<uint64_t>::max();
+
+// One optional deadline per kind of timer. With a handful of kinds a scan
+// beats a heap, and the earliest deadline is cached until something changes.
+// Plain data, so a game holding one can still be copied as bytes.
+template <typename Kind, int Count>
+class DeadlineScheduler {
+ private:
+  std::array<uint64_t, Count> deadlines;
+  mutable Kind earliestKind;
+  mutable uint64_t earliestTime;
+  mutable bool dirty = true;
+
+ public:
+  DeadlineScheduler() { clear(); }
+
+  void arm(Kind kind, uint64_t time) {
+    deadlines[(int)kind] = time;
+    dirty = true;
+  }
+
+  void disarm(Kind kind) { arm(kind, NO_DEADLINE); }
+
+  void clear() {
+    deadlines.fill(NO_DEADLINE);
+    dirty = true;
+  }
+
+  // The earliest armed deadline, ties going to the lowest kind. The time is
+  // NO_DEADLINE when nothing is armed.
+  std::pair<Kind, uint64_t> next() const {
+    if (dirty) {
+      earliestKind = (Kind)0;
+      earliestTime = deadlines[0];
+      for (int i = 1; i < Count; i++) {
+        if (deadlines[i] < earliestTime) {
+          earliestKind = (Kind)i;
+          earliestTime = deadlines[i];
+        }
+      }
+      dirty = false;
+    }
+    return {earliestKind, earliestTime};
+  }
+};
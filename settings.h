@@ -0,0 +1,137 @@
+#pragma once
+
+#include <climits>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "game_modes.h"
+
+// Largest --audio-buffer; the music look-ahead ring holds two of these
+const int MAX_AUDIO_BUFFER_SAMPLES = 8192;
+
+// Options given on the command line as --name or --name=value
+class Settings {
+ private:
+  Settings() = default;
+
+  // Sets `out` only when all of `value` is a number in [min, max]
+  static bool parseInt(const std::string& value, int min, int max, int& out) {
+    int parsed;
+    size_t length;
+    try {
+      parsed = std::stoi(value, &length);
+    } catch (const std::exception&) {
+      return false;
+    }
+    if (length != value.size() || parsed < min || parsed > max) {
+      return false;
+    }
+    out = parsed;
+    return true;
+  }
+
+ public:
+  // Negotiate the smallest audio buffer that runs without underruns
+  bool lowLatencyAudio = false;
+  // Buffer size in sample frames when not in low latency mode
+  int audioBufferSamples = 2048;
+  // Print audio latency and voice counters on exit
+  bool audioStats = false;
+  // Sample input about every millisecond instead of once per frame
+  bool fastInput = false;
+  // Delayed auto shift: how long a held move key waits before repeating
+  int dasMs = 133;
+  // Auto repeat rate once DAS kicks in, 0 moves straight to the wall
+  int arrMs = 10;
+  // Soft drop repeat rate once DAS kicks in, 0 drops straight to the floor
+  int softDropMs = 10;
+  // Frame rate to hold without vsync, 0 follows the display with vsync
+  int targetFps = 0;
+  // Read input just before the predicted vblank instead of right after the
+  // previous present; only has an effect with vsync
+  bool lateLatch = false;
+  // Print frame time statistics on exit
+  bool frameStats = false;
+  // Print input sampling jitter and event age on exit
+  bool inputStats = false;
+  // Append the command list of every presented frame to this file
+  std::string dumpCommands;
+  // Append every piece that locks, with its board, to this file
+  std::string recordPositions;
+  // How frames are drawn: "sdl" through SDL_RenderGeometry, "cpu" with the
+  // software rasterizer, "auto" picks cpu when SDL has no GPU renderer
+  std::string raster = "auto";
+  // Board size, the name of one of GAME_MODES
+  std::string mode = GAME_MODES[0].name;
+
+  static Settings& getInstance() {
+    static Settings settings;
+    return settings;
+  }
+
+  void parse(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      std::string value;
+      size_t equals = arg.find('=');
+      if (equals != std::string::npos) {
+        value = arg.substr(equals + 1);
+        arg = arg.substr(0, equals);
+      }
+
+      bool ok = true;
+      if (arg == "--low-latency") {
+        lowLatencyAudio = true;
+      } else if (arg == "--audio-stats") {
+        audioStats = true;
+      } else if (arg == "--fast-input") {
+        fastInput = true;
+      } else if (arg == "--input-stats") {
+        inputStats = true;
+      } else if (arg == "--das") {
+        ok = parseInt(value, 0, INT_MAX, dasMs);
+      } else if (arg == "--arr") {
+        ok = parseInt(value, 0, INT_MAX, arrMs);
+      } else if (arg == "--soft-drop") {
+        ok = parseInt(value, 0, INT_MAX, softDropMs);
+      } else if (arg == "--fps") {
+        ok = parseInt(value, 0, INT_MAX, targetFps);
+      } else if (arg == "--late-latch") {
+        lateLatch = true;
+      } else if (arg == "--frame-stats") {
+        frameStats = true;
+      } else if (arg == "--dump-commands") {
+        ok = !value.empty();
+        if (ok) {
+          dumpCommands = value;
+        }
+      } else if (arg == "--record-positions") {
+        ok = !value.empty();
+        if (ok) {
+          recordPositions = value;
+        }
+      } else if (arg == "--raster") {
+        ok = value == "auto" || value == "sdl" || value == "cpu";
+        if (ok) {
+          raster = value;
+        }
+      } else if (arg == "--mode") {
+        ok = false;
+        for (const GameMode& gameMode : GAME_MODES) {
+          ok = ok || value == gameMode.name;
+        }
+        if (ok) {
+          mode = value;
+        }
+      } else if (arg == "--audio-buffer") {
+        ok = parseInt(value, 1, MAX_AUDIO_BUFFER_SAMPLES, audioBufferSamples);
+      } else {
+        ok = false;
+      }
+      if (!ok) {
+        std::cout << "ignoring option " << argv[i] << std::endl;
+      }
+    }
+  }
+};
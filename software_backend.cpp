@@ -0,0 +1,219 @@
+#include "software_backend.h"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_render.h>
+#include <algorithm>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RASTER_SSE2
+#endif
+
+#include "font_manager.h"
+#include "game_clock.h"
+
+static uint32_t packColor(SDL_Color color) {
+  return 0xff000000u | (uint32_t)color.r << 16 | (uint32_t)color.g << 8 |
+         color.b;
+}
+
+// Alpha scaled to 0..256 so blending can shift by 8 instead of dividing
+static int blendWeight(int alpha) {
+  return alpha + (alpha >> 7);
+}
+
+static uint32_t blendPixel(uint32_t dst, uint32_t src, int weight) {
+  uint32_t out = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    uint32_t s = (src >> shift) & 0xff;
+    uint32_t d = (dst >> shift) & 0xff;
+    out |= ((s * weight + d * (256 - weight)) >> 8) << shift;
+  }
+  return out;
+}
+
+static void fillSpan(uint32_t* row, int count, uint32_t color) {
+  int i = 0;
+#ifdef RASTER_SSE2
+  __m128i value = _mm_set1_epi32(color);
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_si128((__m128i*)(row + i), value);
+  }
+#endif
+  for (; i < count; i++) {
+    row[i] = color;
+  }
+}
+
+// Same arithmetic as blendPixel, four pixels at a time
+static void blendSpan(uint32_t* row, int count, uint32_t color, int weight) {
+  int i = 0;
+#ifdef RASTER_SSE2
+  __m128i zero = _mm_setzero_si128();
+  __m128i src = _mm_unpacklo_epi8(_mm_set1_epi32(color), zero);
+  __m128i srcTerm = _mm_mullo_epi16(src, _mm_set1_epi16(weight));
+  __m128i inverse = _mm_set1_epi16(256 - weight);
+  for (; i + 4 <= count; i += 4) {
+    __m128i dst = _mm_loadu_si128((const __m128i*)(row + i));
+    __m128i lo = _mm_unpacklo_epi8(dst, zero);
+    __m128i hi = _mm_unpackhi_epi8(dst, zero);
+    lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, inverse), srcTerm),
+                        8);
+    hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, inverse), srcTerm),
+                        8);
+    _mm_storeu_si128((__m128i*)(row + i), _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; i < count; i++) {
+    row[i] = blendPixel(row[i], color, weight);
+  }
+}
+
+void SoftwareBackend::release() {
+  if (texture) {
+    SDL_DestroyTexture(texture);
+  }
+  texture = nullptr;
+  textureRenderer = nullptr;
+}
+
+void SoftwareBackend::resize(int newWidth, int newHeight) {
+  width = newWidth;
+  height = newHeight;
+  pixels.assign((size_t)width * height, 0xff000000u);
+}
+
+void SoftwareBackend::fill(int x, int y, int w, int h, SDL_Color color) {
+  int x0 = std::max(x, 0);
+  int y0 = std::max(y, 0);
+  int x1 = std::min(x + w, width);
+  int y1 = std::min(y + h, height);
+  if (x0 >= x1 || y0 >= y1 || color.a == 0) {
+    return;
+  }
+  uint32_t packed = packColor(color);
+  int weight = blendWeight(color.a);
+  for (int row = y0; row < y1; row++) {
+    uint32_t* span = pixels.data() + (size_t)row * width + x0;
+    if (weight == 256) {
+      fillSpan(span, x1 - x0, packed);
+    } else {
+      blendSpan(span, x1 - x0, packed, weight);
+    }
+  }
+}
+
+void SoftwareBackend::drawText(const CommandList& list,
+                               const RenderCommand& command) {
+  const FontAtlas& atlas = FontManager::getInstance().getAtlas(command.font);
+  if (atlas.coverage.empty()) {
+    return;
+  }
+  uint32_t packed = packColor(command.color);
+  int x = command.x;
+  int y = command.y;
+  for (char c : list.textOf(command)) {
+    const GlyphRect& glyph = atlas.glyphs[(uint8_t)c % GLYPH_COUNT];
+    if (c == '\n') {
+      y += glyph.h;
+      x = command.x;
+      continue;
+    }
+    int x0 = std::max(x, 0);
+    int y0 = std::max(y, 0);
+    int x1 = std::min(x + glyph.w, width);
+    int y1 = std::min(y + glyph.h, height);
+    for (int py = y0; py < y1; py++) {
+      const uint8_t* coverage = atlas.coverage.data() +
+                                (size_t)(glyph.y + py - y) * atlas.width +
+                                glyph.x - x;
+      uint32_t* row = pixels.data() + (size_t)py * width;
+      for (int px = x0; px < x1; px++) {
+        int alpha = coverage[px] * command.color.a / 255;
+        if (alpha) {
+          row[px] = blendPixel(row[px], packed, blendWeight(alpha));
+        }
+      }
+    }
+    x += glyph.w;
+  }
+}
+
+void SoftwareBackend::rasterize(const CommandList& list) {
+  fill(0, 0, width, height,
+       {list.clearColor.r, list.clearColor.g, list.clearColor.b, 255});
+
+  // painter's order, layer by layer
+  const std::vector<RenderCommand>& commands = list.commands;
+  order.resize(commands.size());
+  for (uint32_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return commands[a].layer < commands[b].layer;
+  });
+
+  for (uint32_t index : order) {
+    const RenderCommand& command = commands[index];
+    switch (command.type) {
+      case CommandType::Fill:
+        fill(command.x, command.y, command.w, command.h, command.color);
+        break;
+      case CommandType::Outline:
+        fill(command.x, command.y, command.w, 1, command.color);
+        fill(command.x, command.y + command.h - 1, command.w, 1,
+             command.color);
+        fill(command.x, command.y + 1, 1, command.h - 2, command.color);
+        fill(command.x + command.w - 1, command.y + 1, 1, command.h - 2,
+             command.color);
+        break;
+      case CommandType::Text:
+        drawText(list, command);
+        break;
+      case CommandType::Blit:
+        break;
+    }
+  }
+}
+
+void SoftwareBackend::submit(SDL_Renderer* renderer, const CommandList& list) {
+  int outputWidth;
+  int outputHeight;
+  SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight);
+  if (!texture || textureRenderer != renderer || outputWidth != width ||
+      outputHeight != height) {
+    if (texture) {
+      SDL_DestroyTexture(texture);
+    }
+    resize(outputWidth, outputHeight);
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                SDL_TEXTUREACCESS_STREAMING, width, height);
+    textureRenderer = renderer;
+    if (!texture) {
+      std::cout << "could not create framebuffer texture: " << SDL_GetError()
+                << std::endl;
+      return;
+    }
+  }
+
+  uint64_t start = nowMicros();
+  rasterize(list);
+  uint64_t rasterized = nowMicros();
+  SDL_UpdateTexture(texture, NULL, pixels.data(), width * sizeof(uint32_t));
+  SDL_RenderCopy(renderer, texture, NULL, NULL);
+  drawCalls = 1;
+  textureSwitches = 0;
+
+  frames++;
+  rasterMicros += rasterized - start;
+  uploadMicros += nowMicros() - rasterized;
+}
+
+void SoftwareBackend::report() const {
+  if (frames == 0) {
+    return;
+  }
+  std::cout << "cpu raster: " << rasterMicros / frames / 1000
+            << " ms rasterizing and " << uploadMicros / frames / 1000
+            << " ms uploading per frame" << std::endl;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_render.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "render_backend.h"
+#include "render_commands.h"
+
+// Rasterizes a CommandList into a 32-bit ARGB framebuffer on the CPU and
+// uploads it as one streaming texture per frame. On machines without a
+// GPU this beats feeding hundreds of small rects through SDL's generic
+// software renderer.
+//
+// Blits need texture pixels on the CPU, which only font atlases keep, so
+// Blit commands are skipped here.
+class SoftwareBackend : public CommandBackend {
+ private:
+  std::vector<uint32_t> pixels;
+  int width = 0;
+  int height = 0;
+  SDL_Texture* texture = nullptr;
+  SDL_Renderer* textureRenderer = nullptr;
+  std::vector<uint32_t> order;
+
+  uint64_t frames = 0;
+  double rasterMicros = 0;
+  double uploadMicros = 0;
+
+  void fill(int x, int y, int w, int h, SDL_Color color);
+  void drawText(const CommandList& list, const RenderCommand& command);
+
+ public:
+  // Destroys the framebuffer texture. Call before destroying the renderer
+  // it was made on; nothing here touches SDL on destruction, since a global
+  // backend outlives SDL_Quit.
+  void release();
+
+  const char* name() const override { return "cpu"; }
+
+  // Resizes the framebuffer, clearing it
+  void resize(int newWidth, int newHeight);
+
+  // Draws `list` into the framebuffer without touching SDL
+  void rasterize(const CommandList& list);
+
+  const uint32_t* framebuffer() const { return pixels.data(); }
+
+  void submit(SDL_Renderer* renderer, const CommandList& list) override;
+
+  void report() const override;
+};
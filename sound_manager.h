@@ -4,49 +4,142 @@
 #include <SDL2/SDL_mixer.h>
 #include <SDL2/SDL_render.h>
 #include <SDL2/SDL_surface.h>
+#include <atomic>
+#include <cstring>
 #include <exception>
+#include <filesystem>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
-inline void finishedPreLoop();
+#include "asset_pack.h"
+#include "disk_cache.h"
+#include "music_sequencer.h"
+#include "voice_manager.h"
+
+const int MUSIC_VOLUME = 24;
 
 class SoundManager {
  private:
-  Mix_Music* preloop;
-  Mix_Music* loop;
-  Mix_Chunk* rotate;
-  Mix_Chunk* drop;
-  Mix_Chunk* yay;
-  Mix_Chunk* lose;
+  Mix_Chunk* preloop = nullptr;
+  Mix_Chunk* loop = nullptr;
+  Mix_Chunk* rotate = nullptr;
+  Mix_Chunk* drop = nullptr;
+  Mix_Chunk* yay = nullptr;
+  Mix_Chunk* lose = nullptr;
 
- public:
-  SoundManager() {
-    preloop = Mix_LoadMUS("assets/preloop.ogg");
-    if (!preloop) {
-      throw std::exception();
+  std::vector<MappedFile> pcmCaches;
+  MusicSequencer music;
+  VoiceManager voices;
+
+  std::thread loader;
+  // device buffer in sample frames, for the music look-ahead
+  int bufferSamples = 0;
+  std::atomic<int> assetsLoaded = 0;
+  std::atomic<bool> loadFailed = false;
+
+  // Runs on the loader thread. The game only touches the sounds once
+  // isLoaded() is true, so the pointers don't need their own locking.
+  void loadAssets() {
+    preloop = loadSample("preloop.ogg");
+    if (!loaded(preloop)) {
+      return;
     }
-    loop = Mix_LoadMUS("assets/loop.ogg");
-    if (!loop) {
-      throw std::exception();
+    loop = loadSample("loop.ogg");
+    if (!loaded(loop)) {
+      return;
     }
-    rotate = Mix_LoadWAV("assets/rotate.wav");
-    if (!rotate) {
-      throw std::exception();
+    music.open(preloop, loop, MUSIC_VOLUME, bufferSamples);
+    rotate = loadSample("rotate.wav");
+    if (!loaded(rotate)) {
+      return;
     }
-    drop = Mix_LoadWAV("assets/drop.mp3");
-    if (!drop) {
-      throw std::exception();
+    drop = loadSample("drop.mp3");
+    if (!loaded(drop)) {
+      return;
     }
-    yay = Mix_LoadWAV("assets/yay.mp3");
-    if (!yay) {
-      throw std::exception();
+    yay = loadSample("yay.mp3");
+    if (!loaded(yay)) {
+      return;
+    }
+    lose = loadSample("gameover.wav");
+    loaded(lose);
+  }
+
+  // Sounds are decoded once into the device's exact output format and
+  // kept in cache/, so later launches map the PCM instead of running the
+  // decoders and resamplers again.
+  Mix_Chunk* loadSample(const std::string& name) {
+    AssetData source = AssetPack::getInstance().get(name);
+    if (!source.data) {
+      Mix_SetError("missing asset %s", name.c_str());
+      return NULL;
+    }
+    int frequency;
+    Uint16 format;
+    int channels;
+    if (!Mix_QuerySpec(&frequency, &format, &channels)) {
+      return NULL;
+    }
+    uint64_t key = fnv1a(source.data, source.size);
+    key = fnv1aValue(frequency, key);
+    key = fnv1aValue(format, key);
+    key = fnv1aValue(channels, key);
+    std::string path =
+        cachePath(std::filesystem::path(name).stem().string() + ".pcm");
+
+    auto cached = openCacheFile(path, key);
+    if (cached) {
+      CacheHeader header;
+      std::memcpy(&header, cached->data(), sizeof(header));
+      // QuickLoad doesn't copy, the mapping lives as long as the manager
+      Mix_Chunk* chunk = Mix_QuickLoad_RAW(
+          const_cast<Uint8*>(cachePayload(*cached)), header.payloadSize);
+      if (chunk) {
+        pcmCaches.push_back(std::move(*cached));
+        return chunk;
+      }
+    }
+
+    Mix_Chunk* chunk = Mix_LoadWAV_RW(AssetPack::getInstance().open(name), 1);
+    if (chunk) {
+      writeCacheFile(path, key, {{chunk->abuf, chunk->alen}});
     }
-    lose = Mix_LoadWAV("assets/gameover.wav");
-    if (!lose) {
+    return chunk;
+  }
+
+  bool loaded(void* asset) {
+    if (!asset) {
+      std::cout << "could not load sound: " << Mix_GetError() << std::endl;
+      loadFailed = true;
+      return false;
+    }
+    assetsLoaded++;
+    return true;
+  }
+
+ public:
+  static constexpr int ASSET_COUNT = 6;
+
+  SoundManager() = default;
+
+  // Decodes every sound on a background thread so the first game doesn't
+  // hitch. Call once after Mix_OpenAudio, with the buffer size it opened.
+  void startLoading(int p_bufferSamples) {
+    bufferSamples = p_bufferSamples;
+    voices.initialize();
+    loader = std::thread(&SoundManager::loadAssets, this);
+  }
+
+  int loadedCount() const { return assetsLoaded; }
+
+  bool isLoaded() {
+    if (loadFailed) {
       throw std::exception();
     }
+    return assetsLoaded == ASSET_COUNT;
   }
 
   static SoundManager& getInstance() {
@@ -54,40 +147,34 @@ class SoundManager {
     return soundManager;
   }
 
-  void continueMainTheme() { Mix_PlayMusic(loop, -1); }
-
-  void startMainTheme() {
-    Mix_VolumeMusic(24);
-    Mix_FadeInMusic(preloop, 0, 300);
-    Mix_HookMusicFinished(finishedPreLoop);
-  }
+  void startMainTheme() { music.play(300); }
 
-  void playRotate() { Mix_PlayChannel(-1, rotate, 0); }
+  void playRotate() { voices.play(Sound::Rotate, rotate); }
 
-  void playDrop() { Mix_PlayChannel(-1, drop, 0); }
+  void playDrop() { voices.play(Sound::Drop, drop); }
 
   void playYay() {
-    Mix_FadeOutMusic(50);
-    Mix_HookMusicFinished(NULL);
-    Mix_PlayChannel(-1, yay, 0);
+    music.fadeOut(50);
+    voices.play(Sound::Yay, yay);
   }
 
   void playLose() {
-    Mix_FadeOutMusic(50);
-    Mix_HookMusicFinished(NULL);
-    Mix_PlayChannel(-1, lose, 0);
+    music.fadeOut(50);
+    voices.play(Sound::Lose, lose);
   }
 
+  void reportVoices() const { voices.report(); }
+
   ~SoundManager() {
-    Mix_FreeMusic(preloop);
-    Mix_FreeMusic(loop);
+    if (loader.joinable()) {
+      loader.join();
+    }
+    music.close();
+    Mix_FreeChunk(preloop);
+    Mix_FreeChunk(loop);
     Mix_FreeChunk(rotate);
     Mix_FreeChunk(drop);
     Mix_FreeChunk(yay);
     Mix_FreeChunk(lose);
   }
 };
-
-inline void finishedPreLoop() {
-  SoundManager::getInstance().continueMainTheme();
-}
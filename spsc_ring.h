@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+// Lock-free ring buffer for exactly one producer thread and one consumer
+// thread. Capacity must be a power of two.
+template <typename T, size_t Capacity>
+class SpscRing {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two");
+
+ private:
+  T items[Capacity];
+  // Keep the two indices on separate cache lines so producer and consumer
+  // don't fight over one.
+  alignas(64) std::atomic<size_t> head = 0;
+  alignas(64) std::atomic<size_t> tail = 0;
+
+ public:
+  static constexpr size_t capacity() { return Capacity; }
+
+  // Producer side
+  bool push(const T& item) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == Capacity) {
+      return false;
+    }
+    items[t & (Capacity - 1)] = item;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Producer side, writes as many as fit and returns how many that was
+  size_t write(const T* src, size_t count) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t space = Capacity - (t - head.load(std::memory_order_acquire));
+    count = std::min(count, space);
+    for (size_t i = 0; i < count; i++) {
+      items[(t + i) & (Capacity - 1)] = src[i];
+    }
+    tail.store(t + count, std::memory_order_release);
+    return count;
+  }
+
+  // Consumer side
+  bool pop(T& item) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items[h & (Capacity - 1)];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side, reads as many as are available up to count
+  size_t read(T* dst, size_t count) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t available = tail.load(std::memory_order_acquire) - h;
+    count = std::min(count, available);
+    for (size_t i = 0; i < count; i++) {
+      dst[i] = items[(h + i) & (Capacity - 1)];
+    }
+    head.store(h + count, std::memory_order_release);
+    return count;
+  }
+
+  // Either side; only a snapshot while the other side is running
+  size_t size() const {
+    return tail.load(std::memory_order_acquire) -
+           head.load(std::memory_order_acquire);
+  }
+};
@@ -2,70 +2,81 @@
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_events.h>
-#include <SDL2/SDL_keycode.h>
 #include <SDL2/SDL_render.h>
-#include <SDL2/SDL_stdinc.h>
-#include <SDL2/SDL_timer.h>
-#include <SDL2/SDL_ttf.h>
-#include <sys/types.h>
 
+#include <atomic>
 #include <cstdint>
-#include <ctime>
-#include <iostream>
-#include <optional>
-#include <random>
-#include <vector>
+#include <fstream>
+#include <memory>
+#include <thread>
 
 #include "Scene.h"
+#include "input_sampler.h"
+#include "render_commands.h"
+#include "render_snapshot.h"
+#include "spsc_ring.h"
+#include "tetris_game.h"
+#include "triple_buffer.h"
 
+// The parts of a game frame, in the order they're recorded
+enum class RenderSection { Grid, Piece, Ghost, HoldNext, Text, Count };
+
+// Records one frame of a game from a snapshot
+void renderSnapshot(CommandList& commands, const RenderSnapshot& snapshot);
+
+// Records just one part of the frame, for benchmarks
+void renderSection(CommandList& commands,
+                   const RenderSnapshot& snapshot,
+                   RenderSection section);
+
+// Runs a game on its own thread. Input is handed over through a queue and
+// every step publishes a snapshot that render() draws, so render() never
+// touches live game state.
+//
+// The simulation only runs up to the time of the main thread's last
+// update(), by which point every event pumped before then is queued. An
+// event can then never arrive for a time the game has already simulated,
+// so gravity and repeats stay in order with the keys around them.
 class Tetris : public Scene {
  private:
-  std::vector<std::vector<int>> grid;
-  std::vector<std::vector<int>> currentPiece;
-  int nextType;
-  int heldPieceType;
-  bool canSwap;
-  int curR;
-  int curC;
-  int curType;
-  int curRotation;
-  bool leftPressed = false;
-  bool rightPressed = false;
-  bool downPressed = false;
-  Uint32 lastUpdate;
-  uint32_t leftTimer = 0;
-  uint32_t rightTimer = 0;
-  uint32_t downTimer = 0;
-  std::mt19937 gen;
-  uint32_t startTime;
-  uint32_t finishTime;
-  int linesLeft;
-  std::string gameOverText;
-  bool gameOver;
-  bool canDrop = true;
+  // longest update() waits for the simulation to catch up before the frame
+  // is drawn from an older snapshot, in microseconds
+  static const uint64_t MAX_SIM_WAIT = 4000;
+  // how often to check on a simulation that didn't catch up in time
+  static const uint64_t SIM_POLL = 1000;
 
-  void spawnNewPiece(int spawnType = -1);
-  bool isColliding(std::vector<std::vector<int>>& piece,
-                   int pieceRow,
-                   int pieceCol);
-  void addCurrentPiece();
-  void clearLines();
-  void rotateClockwise();
-  void rotateCounterClockwise();
-  void dropPiece();
-  void progressPieces();
-  void moveLeft();
-  void moveRight();
-  void reset();
-  std::vector<std::vector<int>> getWallKickData(int curRotation,
-                                                int nextRotation);
+  // the game for the board size picked with --mode
+  std::unique_ptr<Game> game;
+  SpscRing<InputEvent, 256> inputs;
+  TripleBuffer<RenderSnapshot> snapshots;
+  std::thread simulation;
+  std::atomic<bool> running = true;
+  // events handed to the simulation thread, and how many it has handled
+  uint64_t eventsSent = 0;
+  std::atomic<uint64_t> eventsHandled = 0;
+  // time the simulation may run up to, set by update()
+  std::atomic<uint64_t> horizon = 0;
+  // written by the simulation after each step: the horizon it reached, the
+  // game's next deadline and whether the game is over
+  std::atomic<uint64_t> simulatedTo = 0;
+  std::atomic<uint64_t> gameDeadline = NO_DEADLINE;
+  std::atomic<bool> gameOver = false;
+  // where locked positions go with --record-positions
+  std::ofstream positionLog;
+
+  void simulate();
 
  public:
   Tetris(SceneManager& sceneManager);
+  ~Tetris();
+
+  void render(CommandList& commands) override;
+
+  void handleInput(const SDL_Event& event, uint64_t time) override;
 
-  void render(SDL_Renderer* renderer) override;
+  void update(uint64_t now) override;
 
-  void handleInput(const SDL_Event& event) override;
+  uint64_t nextDeadline() override;
 
-  void update() override;
+  bool needsRedraw() override;
 };
@@ -0,0 +1,546 @@
+#include "tetris_game.h"
+#include <SDL2/SDL_events.h>
+#include <SDL2/SDL_keycode.h>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "game_clock.h"
+#include "settings.h"
+#include "sound_manager.h"
+
+// gravity intervals, in microseconds
+const uint64_t UPDATE_DELAY = 1000000;
+const uint64_t LAST_ROW_UPDATE_DELAY = 1500000;
+
+const char* WIN_TEXT = "YOU WIN! - Press R to restart";
+const char* LOSE_TEXT = "GAME OVER - Press R to restart";
+
+const Kicks WALL_KICK_I[] = {
+    // 0 -> 1, 3 -> 2
+    {{0, 0}, {-2, 0}, {1, 0}, {-2, -1}, {1, 2}},
+    // 1 -> 0, 2 -> 3
+    {{0, 0}, {2, 0}, {-1, 0}, {2, 1}, {-1, -2}},
+    // 1 -> 2, 0 -> 3
+    {{0, 0}, {-1, 0}, {-2, 0}, {-1, 2}, {2, -1}},
+    // 2 -> 1, 3 -> 0
+    {{0, 0}, {1, 0}, {-2, 0}, {1, -2}, {-2, 1}},
+};
+
+const Kicks WALL_KICK_NONE_I[] = {
+    // 0 -> 1, 2 -> 1
+    {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}},
+    // 1 -> 0, 1 -> 2
+    {{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}},
+    // 2 -> 3, 0 -> 3
+    {{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}},
+    // 3 -> 2, 3 -> 0
+    {{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}},
+};
+
+const Kicks NO_KICKS = {};
+
+template <int Width, int Height>
+TetrisGame<Width, Height>::TetrisGame(uint64_t seed)
+    : nextType(-1),
+      heldPieceType(-1),
+      canSwap(true),
+      simTime(nowMicros()),
+      dasDelay(Settings::getInstance().dasMs * 1000),
+      autoRepeatRate(Settings::getInstance().arrMs * 1000),
+      softDropRate(Settings::getInstance().softDropMs * 1000),
+      gameOver(false) {
+  rng.seed(seed);
+  reset();
+  spawnNewPiece();
+  reschedule();
+}
+
+template <int Width, int Height>
+void TetrisGame<Width, Height>::spawnNewPiece(int spawnType) {
+  if (spawnType == -1) {
+    curType = nextType;
+    nextType = rng.below(PIECE_TYPES);
+    canSwap = true;
+  } else {
+    curType = spawnType;
+  }
+
+  curC = Width / 2 - PIECE_SHAPES[curType][0].size / 2;
+  curR = 0;
+  curRotation = 0;
+  pieceChanged();
+  if (!board.fitsAboveStack(curType, curRotation, curR, curC) &&
+      isColliding(curRotation, curR, curC)) {
+    gameOver = true;
+    won = false;
+    finishTime = simTime;
+    SoundManager::getInstance().playLose();
+  }
+}
+
+template <int Width, int Height>
+void TetrisGame<Width, Height>::reset() {
+  board.clear();
+  landingValid = false;
+  nextType = rng.below(PIECE_TYPES);
+  heldPieceType = -1;
+  linesLeft = LINES_LEFT;
+  gameOver = false;
+  spawnNewPiece();
+  startTime = simTime;
+  lastUpdate = simTime;
+  // after gameOver is cleared, or it would arm no deadlines
+  reschedule();
+  SoundManager::getInstance().startMainTheme();
+}
+
+template <int Width, int Height>
+bool TetrisGame<Width, Height>::isColliding(int rotation,
+                                            int pieceRow,
+                                            int pieceCol) {
+  return board.collides(curType, rotation, pieceRow, pieceCol);
+}
+
+template <int Width, int Height>
+void TetrisGame<Width, Height>::addCurrentPiece() {
+  lastLock = {(int8_t)curType, (int8_t)curRotation, (int8_t)curR,
+              (int8_t)curC, (int8_t)nextType, (int8_t)heldPieceType};
+  lockCount++;
+  board.place(curType, curRotation, curR, curC);
+  landingValid = false;
+}
+
+template <int Width, int Height>
+void TetrisGame<Width, Height>::clearLines() {
+  int cleared = board.clearLines();
+  if (cleared > 0) {
+    landingValid = false;
+    linesLeft = std::max(linesLeft - cleared, 0);
+  }
+
+  if (linesLeft == 0) {
+    gameOver = true;
+    won = true;
+    finishTime = simTime;
+    SoundManager::getInstance().playYay();
+  }
+}
+
+template <int Width, int Height>
+const Kicks& TetrisGame<Width, Height>::getWallKickData(int curRotation,
+                                                        int nextRotation) {
+  // I piece
+  if (curType == 0) {
+    if ((curRotation == 0 && nextRotation == 1) ||
+        (curRotation == 3 && nextRotation == 2)) {
+      return WALL_KICK_I[0];
+    } else if ((curRotation == 1 && nextRotation == 0) ||
+               (curRotation == 2 && nextRotation == 3)) {
+      return WALL_KICK_I[1];
+    } else if ((curRotation == 1 && nextRotation == 2) ||
+               (curRotation == 0 && nextRotation == 3)) {
+      return WALL_KICK_I[2];
+    } else if ((curRotation == 2 && nextRotation == 1) ||
+               (curRotation == 3 && nextRotation == 0)) {
+      return WALL_KICK_I[3];
+    }
+    // none I piece
+  } else {
+    if ((curRotation == 0 && nextRotation == 1) ||
+        (curRotation == 2 && nextRotation == 1)) {
+      return WALL_KICK_NONE_I[0];
+    } else if ((curRotation == 1 && nextRotation == 0) ||
+               (curRotation == 1 && nextRotation == 2)) {
+      return WALL_KICK_NONE_I[1];
+    } else if ((curRotation == 2 && nextRotation == 3) ||
+               (curRotation == 0 && nextRotation == 3)) {
+      return WALL_KICK_NONE_I[2];
+    } else if ((curRotation == 3 && nextRotation == 2) ||
+               (curRotation == 3 && nextRotation == 0)) {
+      return WALL_KICK_NONE_I[3];
+    }
+  }
+  // should never get here
+  std::cout << curRotation << ", " << nextRotation << std::endl;
+  return NO_KICKS;
+}
+
+template <int Width, int Height>
+void TetrisGame<Width, Height>::rotateClockwise() {
+  rotateTo((curRotation + 1) % 4);
+}
+
+template <int Width, int Height>
+void TetrisGame<Width, Height>::rotateCounterClockwise() {
+  rotateTo((curRotation - 1 + 4) % 4);
+}
+
+// Tries each kick in turn and takes the first place the turned piece fits
+template <int Width, int Height>
+void TetrisGame<Width, Height>::rotateTo(int nextRotation) {
+  for (auto& offset : getWallKickData(curRotation, nextRotation)) {
+    int offsetR = -offset[1];
+    int offsetC = offset[0];
+    if (!isColliding(nextRotation, curR + offsetR, curC + offsetC)) {
+      curR = curR + offsetR;
+      curC = curC + offsetC;
+      curRotation = nextRotation;
+      pieceChanged();
+      return;
+    }
+  }
+}
+
+template <int Width, int Height>
+void TetrisGame<Width, Height>::dropPiece() {
+  curR = landingRow();
+
+  addCurrentPiece();
+  clearLines();
+  spawnNewPiece();
+}
+
+template <int Width, int Height>
+void TetrisGame<Width, Height>::progressPieces() {
+  if (gameOver) {
+    return;
+  }
+
+  if (grounded()) {
+    addCurrentPiece();
+    clearLines();
+    spawnNewPiece();
+  } else {
+    curR++;
+  }
+}
+
+template <int Width, int Height>
+bool TetrisGame<Width, Height>::moveLeft() {
+  if (!isColliding(curRotation, curR, curC - 1)) {
+    curC--;
+    landingValid = false;
+    return true;
+  }
+  return false;
+}
+
+template <int Width, int Height>
+bool TetrisGame<Width, Height>::moveRight() {
+  if (!isColliding(curRotation, curR, curC + 1)) {
+    curC++;
+    landingValid = false;
+    return true;
+  }
+  return false;
+}
+
+template <int Width, int Height>
+void TetrisGame<Width, Height>::handleInput(const SDL_Event& event,
+                                            uint64_t time) {
+  // catch the simulation up to the moment the key was pressed, so it sees
+  // gravity and repeats that happened before it in the right order
+  advanceTo(time);
+
+  if (gameOver) {
+    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_r) {
+      reset();
+    }
+    return;
+  }
+
+  if (event.key.repeat) {
+    return;
+  }
+
+  if (event.type == SDL_KEYDOWN) {
+    switch (event.key.keysym.sym) {
+      case SDLK_LEFT:
+        if (!leftPressed) {
+          moveLeft();
+          leftPressed = true;
+          leftTimer = simTime + dasDelay;
+          leftCharged = false;
+        }
+        break;
+      case SDLK_RIGHT:
+        if (!rightPressed) {
+          moveRight();
+          rightPressed = true;
+          rightTimer = simTime + dasDelay;
+          rightCharged = false;
+        }
+        break;
+      case SDLK_UP:
+        rotateClockwise();
+        SoundManager::getInstance().playRotate();
+        break;
+      case SDLK_z:
+        rotateCounterClockwise();
+        SoundManager::getInstance().playRotate();
+        break;
+      case SDLK_r:
+        reset();
+        break;
+      case SDLK_c:
+        if (canSwap) {
+          if (heldPieceType == -1) {
+            heldPieceType = curType;
+            spawnNewPiece();
+          } else {
+            // swap held piece with current piece
+            int nextHeld = curType;
+            spawnNewPiece(heldPieceType);
+            heldPieceType = nextHeld;
+          }
+          lastUpdate = simTime;
+          canSwap = false;
+        }
+        break;
+      case SDLK_DOWN:
+        progressPieces();
+        if (!downPressed) {
+          downPressed = true;
+          downTimer = simTime + dasDelay;
+          downCharged = false;
+        } else {
+          lastUpdate = simTime;
+        }
+        break;
+      case SDLK_SPACE:
+        if (canDrop) {
+          dropPiece();
+          SoundManager::getInstance().playDrop();
+          lastUpdate = simTime;
+          canDrop = false;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  if (event.type == SDL_KEYUP) {
+    switch (event.key.keysym.sym) {
+      case SDLK_LEFT:
+        leftPressed = false;
+        leftCharged = false;
+        break;
+      case SDLK_RIGHT:
+        rightPressed = false;
+        rightCharged = false;
+        break;
+      case SDLK_DOWN:
+        downPressed = false;
+        downCharged = false;
+        break;
+      case SDLK_SPACE:
+        canDrop = true;
+        break;
+      default:
+        break;
+    }
+  }
+
+  applyChargedRepeats();
+  reschedule();
+}
+
+// Re-arms every timer from the current state. Called after anything that
+// could change when gravity or a repeat is next due.
+template <int Width, int Height>
+void TetrisGame<Width, Height>::reschedule() {
+  if (gameOver) {
+    deadlines.clear();
+    return;
+  }
+  // If the piece is colliding below, give the user extra time to make rotation
+  uint64_t updateDelay = grounded() ? LAST_ROW_UPDATE_DELAY : UPDATE_DELAY;
+  deadlines.arm(Deadline::Gravity, lastUpdate + updateDelay);
+
+  if (leftPressed && !rightPressed && !leftCharged) {
+    deadlines.arm(Deadline::Left, leftTimer);
+  } else {
+    deadlines.disarm(Deadline::Left);
+  }
+  if (rightPressed && !leftPressed && !rightCharged) {
+    deadlines.arm(Deadline::Right, rightTimer);
+  } else {
+    deadlines.disarm(Deadline::Right);
+  }
+  if (downPressed && !downCharged) {
+    deadlines.arm(Deadline::Down, downTimer);
+  } else {
+    deadlines.disarm(Deadline::Down);
+  }
+}
+
+// Runs every deadline up to `time` one at a time in time order, so the
+// outcome is the same however the time is split into frames.
+template <int Width, int Height>
+void TetrisGame<Width, Height>::advanceTo(uint64_t time) {
+  while (!gameOver) {
+    auto [deadline, at] = deadlines.next();
+    if (at > time) {
+      break;
+    }
+    simTime = std::max(simTime, at);
+    runDeadline(deadline);
+    applyChargedRepeats();
+    reschedule();
+  }
+  simTime = std::max(simTime, time);
+}
+
+template <int Width, int Height>
+void TetrisGame<Width, Height>::runDeadline(Deadline deadline) {
+  switch (deadline) {
+    case Deadline::Gravity:
+      progressPieces();
+      lastUpdate = simTime;
+      break;
+    case Deadline::Left:
+      if (autoRepeatRate == 0) {
+        leftCharged = true;
+      } else {
+        moveLeft();
+        leftTimer += autoRepeatRate;
+      }
+      break;
+    case Deadline::Right:
+      if (autoRepeatRate == 0) {
+        rightCharged = true;
+      } else {
+        moveRight();
+        rightTimer += autoRepeatRate;
+      }
+      break;
+    case Deadline::Down:
+      if (softDropRate == 0) {
+        downCharged = true;
+      } else {
+        if (!grounded()) {
+          curR++;
+        }
+        downTimer += softDropRate;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// With an ARR or soft drop rate of 0 a held key keeps the piece against the
+// wall or floor after anything that could let it move further.
+template <int Width, int Height>
+void TetrisGame<Width, Height>::applyChargedRepeats() {
+  if (gameOver) {
+    return;
+  }
+  if (leftCharged && leftPressed && !rightPressed) {
+    while (moveLeft()) {
+    }
+  }
+  if (rightCharged && rightPressed && !leftPressed) {
+    while (moveRight()) {
+    }
+  }
+  if (downCharged && downPressed) {
+    curR = landingRow();
+  }
+}
+
+// Call whenever the piece is replaced or rotated
+template <int Width, int Height>
+void TetrisGame<Width, Height>::pieceChanged() {
+  landingValid = false;
+}
+
+template <int Width, int Height>
+int TetrisGame<Width, Height>::landingRow() {
+  if (!landingValid) {
+    cachedLandingRow = board.landingRow(curType, curRotation, curR, curC);
+    landingValid = true;
+  }
+  return cachedLandingRow;
+}
+
+template <int Width, int Height>
+void TetrisGame<Width, Height>::restore(const Position& position) {
+  board.load(position.grid);
+  curType = position.type;
+  curRotation = position.rotation;
+  curR = position.row;
+  curC = position.col;
+  pieceChanged();
+  nextType = position.nextType;
+  heldPieceType = position.heldType;
+  canSwap = true;
+  linesLeft = LINES_LEFT;
+  gameOver = false;
+  reschedule();
+}
+
+template <int Width, int Height>
+typename TetrisGame<Width, Height>::Position
+TetrisGame<Width, Height>::lockedPosition(const TetrisGame& before) const {
+  Position position;
+  std::memcpy(position.grid, before.grid(), sizeof(position.grid));
+  position.type = lastLock.type;
+  position.rotation = lastLock.rotation;
+  position.row = lastLock.row;
+  position.col = lastLock.col;
+  position.nextType = lastLock.nextType;
+  position.heldType = lastLock.heldType;
+  return position;
+}
+
+template <int Width, int Height>
+void TetrisGame<Width, Height>::snapshot(RenderSnapshot& out) {
+  out.width = Width;
+  out.height = Height;
+  for (int r = 0; r < Height; r++) {
+    std::memcpy(out.grid[r], board.grid()[r], Width);
+  }
+
+  const PieceShape& shape = PIECE_SHAPES[curType][curRotation];
+  for (int r = 0; r < MAX_PIECE_SIZE; r++) {
+    for (int c = 0; c < MAX_PIECE_SIZE; c++) {
+      out.piece[r][c] = shape.rows[r] >> c & 1;
+    }
+  }
+  out.pieceSize = shape.size;
+  out.pieceType = curType;
+  out.pieceRow = curR;
+  out.pieceCol = curC;
+
+  out.ghostRow = landingRow();
+
+  out.heldType = heldPieceType;
+  out.nextType = nextType;
+  out.gameOver = gameOver;
+  out.linesLeft = linesLeft;
+  out.elapsedMs = ((gameOver ? finishTime : simTime) - startTime) / 1000;
+  std::snprintf(out.gameOverText, sizeof(out.gameOverText), "%s",
+                !gameOver ? "" : won ? WIN_TEXT : LOSE_TEXT);
+}
+
+std::unique_ptr<Game> Game::create(const std::string& name) {
+  std::unique_ptr<Game> game;
+  forEachMode([&]<int Mode>() {
+    if (name == GAME_MODES[Mode].name) {
+      game = std::make_unique<GameSession<ModeGame<Mode>>>();
+    }
+  });
+  return game;
+}
+
+// one for each of GAME_MODES
+static_assert(MODE_COUNT == 4, "instantiate the game for every mode");
+template class TetrisGame<GAME_MODES[0].width, GAME_MODES[0].height>;
+template class TetrisGame<GAME_MODES[1].width, GAME_MODES[1].height>;
+template class TetrisGame<GAME_MODES[2].width, GAME_MODES[2].height>;
+template class TetrisGame<GAME_MODES[3].width, GAME_MODES[3].height>;
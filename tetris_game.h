@@ -0,0 +1,297 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_events.h>
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "game_modes.h"
+#include "render_snapshot.h"
+#include "rng.h"
+#include "scheduler.h"
+
+const int LINES_LEFT = 40;
+
+// x and y offsets to try in turn when rotating, y pointing up
+const int KICK_TESTS = 5;
+using Kicks = int8_t[KICK_TESTS][2];
+
+enum class Deadline { Gravity, Left, Right, Down, Count };
+
+// The board and the piece in its final place, just before it locks. The
+// game can log these and bench_core replays them as real positions.
+template <int Width, int Height>
+struct GamePosition {
+  int8_t grid[Height][Width];
+  int8_t type;
+  int8_t rotation;
+  int8_t row;
+  int8_t col;
+  int8_t nextType;
+  int8_t heldType;
+};
+
+// The last piece to lock and where, with the next and held types then
+struct LockedPiece {
+  int8_t type;
+  int8_t rotation;
+  int8_t row;
+  int8_t col;
+  int8_t nextType;
+  int8_t heldType;
+};
+
+// Start of a file of positions, which all have the board size given here
+struct PositionLogHeader {
+  uint32_t magic;
+  uint32_t version;
+  int32_t width;
+  int32_t height;
+};
+
+const uint32_t POSITION_LOG_MAGIC = 0x534f5047;
+const uint32_t POSITION_LOG_VERSION = 1;
+
+// What the Tetris scene needs from a game, whatever its board size
+class Game {
+ public:
+  virtual ~Game() = default;
+
+  // From now on every piece that locks is kept for writePositions()
+  virtual void recordPositions() = 0;
+
+  // `time` is the nowMicros() timestamp of the event
+  virtual void handleInput(const SDL_Event& event, uint64_t time) = 0;
+
+  // Runs every deadline up to `time` one at a time in time order, so the
+  // outcome is the same however the time is split into steps.
+  virtual void advanceTo(uint64_t time) = 0;
+
+  virtual bool isOver() const = 0;
+
+  // nowMicros() time of the next deadline, NO_DEADLINE when none is armed
+  virtual uint64_t nextDeadline() const = 0;
+
+  virtual void snapshot(RenderSnapshot& out) = 0;
+
+  // Appends the positions locked since the last call to `out`
+  virtual void writePositions(std::ostream& out) = 0;
+
+  virtual PositionLogHeader positionLogHeader() const = 0;
+
+  // A new game on the board of the mode called `name`, or nullptr when
+  // there's no such mode
+  static std::unique_ptr<Game> create(const std::string& name);
+};
+
+// The rules and state of one 40 line game, without any drawing. Only ever
+// touched by one thread at a time; the Tetris scene runs it on its
+// simulation thread and reads it through snapshots.
+//
+// The whole state, random generator and timers included, is plain data of a
+// few hundred bytes with no pointers into itself, so saving or restoring a
+// game is a plain copy. That's what undo, rollback or a search over moves
+// would build on.
+template <int Width, int Height>
+class TetrisGame {
+  static_assert(Width <= MAX_GRID_WIDTH && Height <= MAX_GRID_HEIGHT,
+                "snapshots have to hold the whole board");
+
+ public:
+  using Position = GamePosition<Width, Height>;
+  static const int WIDTH = Width;
+  static const int HEIGHT = Height;
+
+ private:
+  Board<Width, Height> board;
+  int nextType;
+  int heldPieceType;
+  bool canSwap;
+  int curR;
+  int curC;
+  int curType;
+  int curRotation;
+  bool leftPressed = false;
+  bool rightPressed = false;
+  bool downPressed = false;
+  // simulation time, in nowMicros() time; only moves forward
+  uint64_t simTime;
+  // time of the last gravity step
+  uint64_t lastUpdate;
+  // auto repeat deadlines and intervals, in nowMicros() time
+  uint64_t leftTimer = 0;
+  uint64_t rightTimer = 0;
+  uint64_t downTimer = 0;
+  uint64_t dasDelay;
+  uint64_t autoRepeatRate;
+  uint64_t softDropRate;
+  // held keys with a repeat rate of 0 that have gone past DAS
+  bool leftCharged = false;
+  bool rightCharged = false;
+  bool downCharged = false;
+  DeadlineScheduler<Deadline, (int)Deadline::Count> deadlines;
+  uint64_t startTime;
+  uint64_t finishTime;
+  int linesLeft;
+  bool gameOver;
+  // whether the game ended by clearing every line rather than topping out
+  bool won = false;
+  bool canDrop = true;
+  // where the piece would land. Moving down doesn't change it; anything
+  // else that moves the piece or changes the board clears landingValid.
+  int cachedLandingRow = 0;
+  bool landingValid = false;
+  // draws the piece types
+  RNG rng;
+  // the game keeps no log of its own, so copies never record; a recorder
+  // compares lockCount before and after a call instead
+  LockedPiece lastLock = {};
+  uint32_t lockCount = 0;
+
+  void spawnNewPiece(int spawnType = -1);
+  // whether the current piece type in `rotation` collides at that place
+  bool isColliding(int rotation, int pieceRow, int pieceCol);
+  void addCurrentPiece();
+  void clearLines();
+  void rotateClockwise();
+  void rotateCounterClockwise();
+  void rotateTo(int nextRotation);
+  void dropPiece();
+  void progressPieces();
+  bool moveLeft();
+  bool moveRight();
+  void reschedule();
+  void runDeadline(Deadline deadline);
+  void applyChargedRepeats();
+  void reset();
+  void pieceChanged();
+  int landingRow();
+  // whether the piece is resting on something
+  bool grounded() { return landingRow() == curR; }
+  const Kicks& getWallKickData(int curRotation, int nextRotation);
+
+  // lets the core benchmarks call the private operations
+  template <typename G>
+  friend struct TetrisGameBench;
+
+ public:
+  // A new game with its pieces drawn from `seed`
+  explicit TetrisGame(uint64_t seed = RNG::randomSeed());
+
+  // Puts the game in `position` with its piece in play
+  void restore(const Position& position);
+
+  // `time` is the nowMicros() timestamp of the event
+  void handleInput(const SDL_Event& event, uint64_t time);
+
+  // Runs every deadline up to `time` one at a time in time order, so the
+  // outcome is the same however the time is split into steps.
+  void advanceTo(uint64_t time);
+
+  bool isOver() const { return gameOver; }
+
+  void snapshot(RenderSnapshot& out);
+
+  // time of the next deadline, NO_DEADLINE when nothing is armed
+  uint64_t nextDeadline() const {
+    return gameOver ? NO_DEADLINE : deadlines.next().second;
+  }
+
+  const typename Board<Width, Height>::Cells& grid() const {
+    return board.grid();
+  }
+  uint32_t locks() const { return lockCount; }
+  // The last piece to lock on the board of `before`, a copy of this game
+  // from just before the call that locked it
+  Position lockedPosition(const TetrisGame& before) const;
+
+  int columnHeight(int c) const { return board.columnHeight(c); }
+  int columnHoleCount(int c) const { return board.columnHoleCount(c); }
+  int holeCount() const { return board.holeCount(); }
+};
+
+// Runs a TetrisGame for the Tetris scene, and records the pieces that lock
+template <typename G>
+class GameSession : public Game {
+  static_assert(std::is_trivially_copyable_v<G>,
+                "game state has to copy as plain bytes");
+
+ private:
+  G game;
+  bool recording = false;
+  std::vector<typename G::Position> lockedPositions;
+
+  // Runs `call` on the game and, when recording, keeps the piece it locked
+  // with the board from before the call. That's only right for calls that
+  // lock at most one piece, which advanceTo() makes sure of.
+  template <typename F>
+  void run(F&& call) {
+    if (!recording) {
+      call();
+      return;
+    }
+    G before = game;
+    call();
+    if (game.locks() == before.locks()) {
+      return;
+    }
+    lockedPositions.push_back(game.lockedPosition(before));
+  }
+
+ public:
+  void recordPositions() override { recording = true; }
+
+  void handleInput(const SDL_Event& event, uint64_t time) override {
+    advanceTo(time);
+    run([&] { game.handleInput(event, time); });
+  }
+
+  // While recording, goes one deadline at a time so each step locks at
+  // most one piece. The outcome is the same either way.
+  void advanceTo(uint64_t time) override {
+    while (recording && game.nextDeadline() <= time) {
+      uint64_t next = game.nextDeadline();
+      run([&] { game.advanceTo(next); });
+    }
+    run([&] { game.advanceTo(time); });
+  }
+
+  bool isOver() const override { return game.isOver(); }
+
+  uint64_t nextDeadline() const override { return game.nextDeadline(); }
+
+  void snapshot(RenderSnapshot& out) override { game.snapshot(out); }
+
+  void writePositions(std::ostream& out) override {
+    if (lockedPositions.empty()) {
+      return;
+    }
+    out.write((const char*)lockedPositions.data(),
+              lockedPositions.size() * sizeof(typename G::Position));
+    lockedPositions.clear();
+  }
+
+  PositionLogHeader positionLogHeader() const override {
+    return {POSITION_LOG_MAGIC, POSITION_LOG_VERSION, G::WIDTH, G::HEIGHT};
+  }
+};
+
+// The game for GAME_MODES[Mode]
+template <int Mode>
+using ModeGame = TetrisGame<GAME_MODES[Mode].width, GAME_MODES[Mode].height>;
+
+// Calls `f.template operator()<Mode>()` for every mode, for code that has
+// to pick an instantiation from a mode known only at run time
+template <typename F>
+void forEachMode(F&& f) {
+  [&]<int... Mode>(std::integer_sequence<int, Mode...>) {
+    (f.template operator()<Mode>(), ...);
+  }(std::make_integer_sequence<int, MODE_COUNT>());
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_render.h>
+
+#include <cstdint>
+#include <vector>
+
+struct TextureInfo {
+  SDL_Texture* texture;
+  int width;
+  int height;
+};
+
+// Hands out small ids for textures so render commands can refer to them
+// without pointers. Ids follow registration order, so a recorded command
+// list replays correctly as long as textures are registered the same way.
+class TextureRegistry {
+ private:
+  // id 0 is reserved for "no texture"
+  std::vector<TextureInfo> textures = {{nullptr, 0, 0}};
+
+  TextureRegistry() = default;
+
+ public:
+  static TextureRegistry& getInstance() {
+    static TextureRegistry registry;
+    return registry;
+  }
+
+  uint16_t add(SDL_Texture* texture) {
+    TextureInfo info = {texture, 0, 0};
+    SDL_QueryTexture(texture, NULL, NULL, &info.width, &info.height);
+    textures.push_back(info);
+    return textures.size() - 1;
+  }
+
+  const TextureInfo& get(uint16_t id) const {
+    return id < textures.size() ? textures[id] : textures[0];
+  }
+};
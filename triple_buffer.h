@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer for exactly one writer thread and one reader
+// thread. The writer always has a slot of its own to fill and the reader
+// always has a complete one to look at, so neither ever waits; the reader
+// just skips any values it was too slow to see.
+template <typename T>
+class TripleBuffer {
+ private:
+  static const uint8_t INDEX_MASK = 3;
+  // set on the shared slot index when the writer published into it and the
+  // reader hasn't picked it up yet
+  static const uint8_t FRESH = 4;
+
+  T slots[3] = {};
+  int writeSlot = 0;
+  int readSlot = 1;
+  alignas(64) std::atomic<uint8_t> shared = 2;
+
+ public:
+  // Writer side: fill this in, then publish()
+  T& back() { return slots[writeSlot]; }
+
+  void publish() {
+    uint8_t old = shared.exchange(writeSlot | FRESH, std::memory_order_acq_rel);
+    writeSlot = old & INDEX_MASK;
+  }
+
+  // Reader side: whether a newer value than front() is waiting
+  bool fresh() const { return shared.load(std::memory_order_acquire) & FRESH; }
+
+  // Swaps in the newest published value, if there is one
+  bool acquire() {
+    if (!fresh()) {
+      return false;
+    }
+    uint8_t old = shared.exchange(readSlot, std::memory_order_acq_rel);
+    readSlot = old & INDEX_MASK;
+    return true;
+  }
+
+  const T& front() const { return slots[readSlot]; }
+};
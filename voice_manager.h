@@ -0,0 +1,159 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <SDL2/SDL_timer.h>
+#include <array>
+#include <cstdint>
+#include <iostream>
+
+#include "audio_monitor.h"
+
+enum class Sound { Rotate, Drop, Yay, Lose, Count };
+
+const int SOUND_COUNT = (int)Sound::Count;
+
+struct SoundPolicy {
+  const char* name;
+  // higher wins when every voice is busy
+  int priority;
+  int maxVoices;
+  // retriggers closer together than this are skipped
+  uint32_t minRetriggerMs;
+};
+
+const SoundPolicy SOUND_POLICIES[SOUND_COUNT] = {
+    {"rotate", 1, 3, 15},
+    {"drop", 2, 2, 0},
+    {"yay", 3, 1, 0},
+    {"lose", 3, 1, 0}};
+
+struct SoundCounters {
+  uint64_t played = 0;
+  uint64_t rateLimited = 0;
+  uint64_t stolen = 0;
+  uint64_t dropped = 0;
+};
+
+// Hands out mixer channels itself instead of Mix_PlayChannel(-1, ...), so a
+// burst of rotations can't crowd out the lock sound. Only used from the
+// Tetris scene's simulation thread, where TetrisGame plays every sound;
+// finished voices are noticed lazily with Mix_Playing.
+class VoiceManager {
+ private:
+  static const int VOICE_COUNT = 8;
+
+  struct Voice {
+    int sound = -1;
+    uint32_t startedAt = 0;
+  };
+
+  std::array<Voice, VOICE_COUNT> voices;
+  std::array<uint32_t, SOUND_COUNT> lastTrigger = {};
+  std::array<SoundCounters, SOUND_COUNT> counters;
+
+  void reclaimFinished() {
+    for (int i = 0; i < VOICE_COUNT; i++) {
+      if (voices[i].sound >= 0 && !Mix_Playing(i)) {
+        voices[i].sound = -1;
+      }
+    }
+  }
+
+  // With byPriority the lowest priority voice goes first, then the oldest
+  static bool isOlder(const Voice& a, const Voice& b, bool byPriority) {
+    int priorityA = SOUND_POLICIES[a.sound].priority;
+    int priorityB = SOUND_POLICIES[b.sound].priority;
+    if (byPriority && priorityA != priorityB) {
+      return priorityA < priorityB;
+    }
+    return a.startedAt < b.startedAt;
+  }
+
+  // Oldest voice among those playing `sound`, or among every voice whose
+  // priority is at most `priority` when sound is -1
+  int oldestVoice(int sound, int priority) {
+    int oldest = -1;
+    for (int i = 0; i < VOICE_COUNT; i++) {
+      const Voice& voice = voices[i];
+      if (voice.sound < 0) {
+        continue;
+      }
+      bool candidate =
+          sound >= 0 ? voice.sound == sound
+                     : SOUND_POLICIES[voice.sound].priority <= priority;
+      if (!candidate) {
+        continue;
+      }
+      if (oldest < 0 || isOlder(voice, voices[oldest], sound < 0)) {
+        oldest = i;
+      }
+    }
+    return oldest;
+  }
+
+ public:
+  void initialize() { Mix_AllocateChannels(VOICE_COUNT); }
+
+  void play(Sound sound, Mix_Chunk* chunk) {
+    int id = (int)sound;
+    const SoundPolicy& policy = SOUND_POLICIES[id];
+    SoundCounters& counter = counters[id];
+    uint32_t now = SDL_GetTicks();
+
+    if (counter.played > 0 && now - lastTrigger[id] < policy.minRetriggerMs) {
+      counter.rateLimited++;
+      return;
+    }
+
+    reclaimFinished();
+    int active = 0;
+    int freeVoice = -1;
+    for (int i = 0; i < VOICE_COUNT; i++) {
+      if (voices[i].sound == id) {
+        active++;
+      } else if (voices[i].sound < 0 && freeVoice < 0) {
+        freeVoice = i;
+      }
+    }
+
+    int channel = freeVoice;
+    if (active >= policy.maxVoices) {
+      channel = oldestVoice(id, policy.priority);
+    } else if (channel < 0) {
+      channel = oldestVoice(-1, policy.priority);
+    }
+    if (channel < 0) {
+      counter.dropped++;
+      return;
+    }
+    if (voices[channel].sound >= 0) {
+      counters[voices[channel].sound].stolen++;
+      Mix_HaltChannel(channel);
+    }
+
+    if (Mix_PlayChannel(channel, chunk, 0) < 0) {
+      voices[channel].sound = -1;
+      counter.dropped++;
+      return;
+    }
+    voices[channel] = {id, now};
+    lastTrigger[id] = now;
+    counter.played++;
+    AudioMonitor::getInstance().markTrigger();
+  }
+
+  const SoundCounters& getCounters(Sound sound) const {
+    return counters[(int)sound];
+  }
+
+  void report() const {
+    for (int i = 0; i < SOUND_COUNT; i++) {
+      const SoundCounters& counter = counters[i];
+      std::cout << SOUND_POLICIES[i].name << ": " << counter.played
+                << " played, " << counter.rateLimited << " rate limited, "
+                << counter.stolen << " stolen, " << counter.dropped
+                << " dropped" << std::endl;
+    }
+  }
+};